@@ -0,0 +1,96 @@
+// Pending-event set for the discrete-event simulation: a binary min-heap
+// ordered by (time, insertion sequence).
+//
+// Ties are broken by insertion order, so two runs that schedule the same
+// events always process them in the same order.
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef enum {
+    EV_ARRIVAL,     // the next vehicle(s) from the ingest stream join their lanes
+    EV_PHASE,       // the controller picks the next green road
+    EV_DEPARTURE,   // the head vehicle of (road, lane) leaves the junction
+    EV_FRAME        // --record captures the view
+} EventType;
+
+typedef struct {
+    unsigned long long time;  // simulated ms
+    unsigned long long seq;   // insertion order, tie-breaker
+    EventType type;
+    int road;
+    int lane;
+} Event;
+
+typedef struct {
+    Event* heap;
+    size_t count;
+    size_t capacity;
+    unsigned long long nextSeq;
+} EventQueue;
+
+static inline void eqInit(EventQueue* q){
+    memset(q,0,sizeof(*q));
+}
+
+static inline void eqFree(EventQueue* q){
+    free(q->heap);
+    eqInit(q);
+}
+
+static inline bool eqEmpty(const EventQueue* q){
+    return q->count==0;
+}
+
+static inline bool eqBefore(const Event* a, const Event* b){
+    return a->time<b->time || (a->time==b->time && a->seq<b->seq);
+}
+
+// Schedule an event. Returns false only if memory ran out.
+static bool eqPush(EventQueue* q, unsigned long long time, EventType type, int road, int lane){
+    if(q->count==q->capacity){
+        size_t cap = q->capacity ? q->capacity*2 : 64;
+        Event* heap = (Event*)realloc(q->heap,cap*sizeof(Event));
+        if(!heap) return false;
+        q->heap = heap;
+        q->capacity = cap;
+    }
+    Event e = {time,q->nextSeq++,type,road,lane};
+    size_t i = q->count++;
+    while(i>0){
+        size_t parent = (i-1)/2;
+        if(!eqBefore(&e,&q->heap[parent])) break;
+        q->heap[i] = q->heap[parent];
+        i = parent;
+    }
+    q->heap[i] = e;
+    return true;
+}
+
+// Earliest pending event; the queue must not be empty
+static inline const Event* eqPeek(const EventQueue* q){
+    return &q->heap[0];
+}
+
+// Remove the earliest event into *out. Returns false when empty.
+static bool eqPop(EventQueue* q, Event* out){
+    if(q->count==0) return false;
+    *out = q->heap[0];
+    Event last = q->heap[--q->count];
+    size_t i = 0, n = q->count;
+    while(1){
+        size_t child = 2*i+1;
+        if(child>=n) break;
+        if(child+1<n && eqBefore(&q->heap[child+1],&q->heap[child])) child++;
+        if(!eqBefore(&q->heap[child],&last)) break;
+        q->heap[i] = q->heap[child];
+        i = child;
+    }
+    if(n) q->heap[i] = last;
+    return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+// FIFO of vehicles waiting in one lane, backed by a power-of-two ring buffer.
+//
+// Push and pop are O(1). When the ring is full it doubles in size, so memory is
+// only allocated O(log n) times over the life of a queue, never per vehicle.
+#ifndef LANE_QUEUE_H
+#define LANE_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define LQ_INITIAL_CAPACITY 16
+
+// Vehicle structure
+typedef struct {
+    char id[10];
+    char road;   // A/B/C/D
+    int lane;    // 1/2/3
+    unsigned long long arrivedMs;  // simulation time the vehicle joined its queue
+    unsigned long long departedMs; // simulation time it left the junction (0 while queued)
+} Vehicle;
+
+typedef struct {
+    Vehicle* items;
+    size_t mask;     // capacity-1; capacity is a power of two (0 before the first push)
+    size_t head;     // index of the oldest vehicle, grows without bound and is masked on access
+    size_t tail;     // one past the newest vehicle
+} LaneQueue;
+
+static inline void lqInit(LaneQueue* q){
+    memset(q,0,sizeof(*q));
+}
+
+static inline void lqFree(LaneQueue* q){
+    free(q->items);
+    lqInit(q);
+}
+
+static inline size_t lqSize(const LaneQueue* q){
+    return q->tail - q->head;
+}
+
+static inline bool lqEmpty(const LaneQueue* q){
+    return q->tail == q->head;
+}
+
+// Drop all vehicles but keep the buffer for reuse
+static inline void lqClear(LaneQueue* q){
+    q->head = q->tail = 0;
+}
+
+// Double the capacity, unwrapping the ring so the oldest vehicle lands at index 0
+static bool lqGrow(LaneQueue* q){
+    size_t cap = q->items ? (q->mask+1)*2 : LQ_INITIAL_CAPACITY;
+    Vehicle* items = (Vehicle*)malloc(cap*sizeof(Vehicle));
+    if(!items) return false;
+    size_t n = lqSize(q);
+    if(n){
+        size_t first = q->head & q->mask;
+        size_t run = (q->mask+1) - first;
+        if(run > n) run = n;
+        memcpy(items, q->items+first, run*sizeof(Vehicle));
+        memcpy(items+run, q->items, (n-run)*sizeof(Vehicle));
+    }
+    free(q->items);
+    q->items = items;
+    q->mask = cap-1;
+    q->head = 0;
+    q->tail = n;
+    return true;
+}
+
+// Append a copy of *v. Returns false only if memory ran out.
+static inline bool lqPush(LaneQueue* q, const Vehicle* v){
+    if(!q->items || lqSize(q) > q->mask){
+        if(!lqGrow(q)) return false;
+    }
+    q->items[q->tail++ & q->mask] = *v;
+    return true;
+}
+
+// Remove the oldest vehicle into *out (if non-NULL). Returns false when empty.
+static inline bool lqPop(LaneQueue* q, Vehicle* out){
+    if(lqEmpty(q)) return false;
+    if(out) *out = q->items[q->head & q->mask];
+    q->head++;
+    return true;
+}
+
+// i-th vehicle from the front (0 = next to leave); i must be < lqSize(q)
+static inline Vehicle* lqAt(const LaneQueue* q, size_t i){
+    return &q->items[(q->head+i) & q->mask];
+}
+
+#endif
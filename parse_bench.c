@@ -0,0 +1,163 @@
+// Microbenchmark: fgets + sscanf (the old readVehicles() path) against the
+// memory-mapped SIMD parser in vehicle_parse.h.
+//
+//   gcc -O2 parse_bench.c -o parse_bench && ./parse_bench [size_mb] [file]
+//   gcc -O2 -mavx2 parse_bench.c -o parse_bench     (AVX2 newline scan)
+//
+// A synthetic file of size_mb megabytes (default 1024) is generated once in
+// the generator's format and reused on later runs.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "vehicle_parse.h"
+
+#define BENCH_FILE "bench_vehicles.data"
+
+typedef struct {
+    char id[10];
+    char road;
+    int lane;
+} Vehicle;
+
+// Results are folded into a checksum so both parsers can be compared and nothing is optimized away
+typedef struct {
+    long long records;
+    long long lane2[4];
+    unsigned long long idHash;
+} Tally;
+
+static double nowSeconds(){
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart/(double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+#endif
+}
+
+static void tally(Tally* t, const Vehicle* v){
+    t->records++;
+    if(v->lane==2 && v->road>='A' && v->road<='D') t->lane2[v->road-'A']++;
+    for(const char* c=v->id;*c;c++) t->idHash = t->idHash*31 + (unsigned char)*c;
+}
+
+static void generateVehicleNumber(char* buffer){
+    buffer[0] = 'A' + rand() % 26;
+    buffer[1] = 'A' + rand() % 26;
+    buffer[2] = '0' + rand() % 10;
+    buffer[3] = 'A' + rand() % 26;
+    buffer[4] = 'A' + rand() % 26;
+    buffer[5] = '0' + rand() % 10;
+    buffer[6] = '0' + rand() % 10;
+    buffer[7] = '0' + rand() % 10;
+    buffer[8] = '\0';
+}
+
+static long long fileSize(const char* path){
+    FILE* f = fopen(path,"rb");
+    if(!f) return -1;
+#ifdef _WIN32
+    _fseeki64(f,0,SEEK_END);
+    long long n = _ftelli64(f);
+#else
+    fseeko(f,0,SEEK_END);
+    long long n = (long long)ftello(f);
+#endif
+    fclose(f);
+    return n;
+}
+
+static int generate(const char* path, long long bytes){
+    FILE* f = fopen(path,"wb");
+    if(!f){ perror("Error creating benchmark file"); return 0; }
+    srand(42);
+    static char buf[1<<16];
+    size_t used = 0;
+    for(long long written=0; written<bytes; written+=VP_RECORD_LEN){
+        if(used+VP_RECORD_LEN > sizeof(buf)){ fwrite(buf,1,used,f); used=0; }
+        char id[9];
+        generateVehicleNumber(id);
+        used += (size_t)sprintf(buf+used,"%c %d %s\n","ABCD"[rand()%4],rand()%3+1,id);
+    }
+    fwrite(buf,1,used,f);
+    fclose(f);
+    return 1;
+}
+
+static Tally benchSscanf(const char* path){
+    Tally t = {0};
+    FILE* f = fopen(path,"r");
+    if(!f) return t;
+    char line[50];
+    while(fgets(line,sizeof(line),f)){
+        line[strcspn(line,"\n")]=0;
+        Vehicle v;
+        if(sscanf(line,"%c %d %9s",&v.road,&v.lane,v.id)==3) tally(&t,&v);
+    }
+    fclose(f);
+    return t;
+}
+
+static Tally benchMapped(const char* path, long long size){
+    Tally t = {0};
+    MappedFile m;
+    if(!mapFile(&m,path,0,(size_t)size)) return t;
+    VehicleScanner sc;
+    vsInit(&sc,m.data,m.len);
+    Vehicle v;
+    int r;
+    while((r=vsNext(&sc,&v.road,&v.lane,v.id))>=0){
+        if(r) tally(&t,&v);
+    }
+    unmapFile(&m);
+    return t;
+}
+
+static void report(const char* name, double secs, long long size, const Tally* t){
+    printf("%-14s %8.3f s  %9.1f MB/s  %12.0f records/s  (records=%lld hash=%016llx)\n",
+           name, secs, size/1048576.0/secs, t->records/secs, t->records, t->idHash);
+}
+
+int main(int argc, char* argv[]){
+    long long mb = argc>1 ? atoll(argv[1]) : 1024;
+    const char* path = argc>2 ? argv[2] : BENCH_FILE;
+    long long want = mb*1048576LL;
+
+    long long size = fileSize(path);
+    if(size<want){
+        printf("Generating %lld MB of records in %s...\n", mb, path);
+        if(!generate(path,want)) return 1;
+        size = fileSize(path);
+    }
+#if defined(VP_AVX2)
+    printf("parser: AVX2 newline scan, SSE2 layout check\n");
+#elif defined(VP_SSE2)
+    printf("parser: SSE2\n");
+#else
+    printf("parser: scalar\n");
+#endif
+
+    // warm the page cache so both runs read from memory
+    benchMapped(path,size);
+
+    double t0 = nowSeconds();
+    Tally a = benchSscanf(path);
+    double t1 = nowSeconds();
+    Tally b = benchMapped(path,size);
+    double t2 = nowSeconds();
+
+    report("fgets+sscanf",t1-t0,size,&a);
+    report("mmap+simd",t2-t1,size,&b);
+    printf("speedup        %8.2fx\n", (t1-t0)/(t2-t1));
+
+    if(a.records!=b.records || a.idHash!=b.idHash || memcmp(a.lane2,b.lane2,sizeof(a.lane2))!=0){
+        printf("MISMATCH between parsers\n");
+        return 1;
+    }
+    return 0;
+}
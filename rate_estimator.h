@@ -0,0 +1,85 @@
+// Streaming arrival-rate estimate for one lane: a sliding-window count and an exponentially
+// weighted moving average, both kept per fixed-size time bucket.
+//
+// An arrival increments the count of the bucket it falls in; only when time moves into a new
+// bucket is the finished one folded into the EWMA and the oldest one dropped from the window.
+// That is O(1) per arrival, with no allocation and no floating-point work unless a bucket
+// boundary was crossed.
+// Times are simulated ms counted from 0 and must not go backwards by more than a bucket.
+#ifndef RATE_ESTIMATOR_H
+#define RATE_ESTIMATOR_H
+
+#include <SDL2/SDL_stdinc.h>
+#include <string.h>
+
+#define RE_BUCKET_MS 1000ULL    // resolution of both estimates
+#define RE_BUCKETS 8            // sliding window length in buckets; a power of two
+#define RE_EWMA_KEEP 0.95       // weight the EWMA keeps per bucket: a time constant of ~20 buckets
+#define RE_IDLE_BUCKETS 512     // after this long without arrivals both estimates are simply zeroed
+
+typedef struct {
+    unsigned long long bucket;        // index (ms / RE_BUCKET_MS) of the newest bucket
+    unsigned counts[RE_BUCKETS];      // arrivals per bucket, newest at bucket % RE_BUCKETS
+    unsigned long long window;        // sum of counts
+    double ewma;                      // arrivals per bucket, over every bucket before the newest
+} RateEstimator;
+
+static inline void reInit(RateEstimator* e){
+    memset(e,0,sizeof(*e));
+}
+
+// RE_EWMA_KEEP^k; only needed when a bucket boundary is crossed
+static inline double reKeep(unsigned long long k){
+    return SDL_pow(RE_EWMA_KEEP,(double)k);
+}
+
+// Move the newest bucket forward to index b. The buckets skipped over had no arrivals, so the
+// EWMA takes the newest count and then decays once per bucket, done here in closed form; the
+// window drops at most RE_BUCKETS old counts.
+static inline void reAdvance(RateEstimator* e, unsigned long long b){
+    if(b<=e->bucket) return;
+    unsigned long long steps = b-e->bucket;
+    if(steps>RE_IDLE_BUCKETS){
+        reInit(e);
+        e->bucket = b;
+        return;
+    }
+    e->ewma = reKeep(steps-1)*(RE_EWMA_KEEP*e->ewma + (1-RE_EWMA_KEEP)*e->counts[e->bucket%RE_BUCKETS]);
+    if(steps>=RE_BUCKETS){
+        memset(e->counts,0,sizeof(e->counts));
+        e->window = 0;
+    }
+    else for(unsigned long long i=1;i<=steps;i++){
+        unsigned* oldest = &e->counts[(e->bucket+i)%RE_BUCKETS];
+        e->window -= *oldest;
+        *oldest = 0;
+    }
+    e->bucket = b;
+}
+
+static inline void reArrive(RateEstimator* e, unsigned long long ms){
+    reAdvance(e,ms/RE_BUCKET_MS);
+    e->counts[e->bucket%RE_BUCKETS]++;
+    e->window++;
+}
+
+// Arrivals per second as of ms: over the sliding window (which reacts to a burst within a
+// bucket or two) and from the EWMA (which carries the longer trend through short gaps).
+// Works out what reAdvance() would do without changing e.
+static inline void reRates(const RateEstimator* e, unsigned long long ms, double* windowPerSec, double* ewmaPerSec){
+    unsigned long long b = ms/RE_BUCKET_MS, window = e->window;
+    double ewma = e->ewma;
+    if(b>e->bucket+RE_IDLE_BUCKETS) window = 0, ewma = 0;
+    else if(b>e->bucket){
+        unsigned long long steps = b-e->bucket;
+        ewma = reKeep(steps-1)*(RE_EWMA_KEEP*ewma + (1-RE_EWMA_KEEP)*e->counts[e->bucket%RE_BUCKETS]);
+        if(steps>=RE_BUCKETS) window = 0;
+        else for(unsigned long long i=1;i<=steps;i++) window -= e->counts[(e->bucket+i)%RE_BUCKETS];
+    }
+    unsigned long long span = (RE_BUCKETS-1)*RE_BUCKET_MS + ms%RE_BUCKET_MS + 1;
+    if(span>ms+1) span = ms+1;   // the window reaches back to before time 0
+    *windowPerSec = window*1000.0/span;
+    *ewmaPerSec = ewma*1000.0/RE_BUCKET_MS;
+}
+
+#endif
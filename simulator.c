@@ -1,81 +1,571 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
-#include <windows.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "vehicle_parse.h"
+#include "vehicle_log.h"
+#include "lane_queue.h"
+#include "spsc_ring.h"
+#include "event_queue.h"
+#include "rate_estimator.h"
+#include "text_cache.h"
+#include "triple_buffer.h"
+#include "sparkline.h"
+#include "png_writer.h"
+#include "work_pool.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <direct.h>
+#define fseeko _fseeki64
+#define ftello _ftelli64
+typedef long long off_t64;
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+typedef off_t off_t64;
+#endif
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 800 
 #define ROAD_WIDTH 150
 #define LANE_WIDTH 50
-#define MAX_VEHICLES 100
+#define NUM_ROADS 4
+#define NUM_LANES 3
+#define NUM_MOVEMENTS (NUM_ROADS*NUM_LANES) // one per lane: right, straight on or left
+#define MOVEMENT(road,lane) (1u<<((road)*NUM_LANES+(lane))) // bit of a movement in a phase's set
+#define MAX_PHASES NUM_MOVEMENTS
+#define PRIORITY_LANE 2
+#define PRIORITY_HIGH_WATER 10   // a priority lane longer than this takes the green...
+#define PRIORITY_LOW_WATER 5     // ...and keeps it until it is shorter than this
+#define DEFAULT_MAX_WAIT_MS 60000 // round robin: a road with vehicles red this long goes next
 #define MAIN_FONT "C:\\Windows\\Fonts\\Arial.ttf"
 #define VEHICLE_FILE "vehicles.data"
+#define FOLLOW_TIMEOUT_MS 1000   // re-check the file even if no change notification arrives
+#define PHASE_MS 5000            // round robin: length of every phase
+#define DEFAULT_MIN_GREEN_MS 2000 // max pressure: shortest green, one headway at the default flow
+#define PRESSURE_STEP_MS 1000    // max pressure: how often a green past its minimum is reconsidered
+#define DEFAULT_MAX_GREEN_MS 30000 // queue-proportional: longest green
+#define DEFAULT_HORIZON_MS 5000  // how far ahead lane queues are forecast for the policies
+#define TEXT_ARRIVAL_MS 1000     // text lines carry no time; traffic_generator.c writes one per second
+#define MAX_OBSERVERS 4
+#define DEFAULT_FLOW 0.5         // saturation flow per lane while green, vehicles/s
+#define ARM_LENGTH (WINDOW_HEIGHT/2 - ROAD_WIDTH/2) // stop line to window edge
+#define VEHICLE_CELL_MAX 12      // px per queued vehicle while queues are short
+#define VEHICLE_CELL_MIN 1       // smallest cell; vehicles past the end of the arm are not drawn
+#define DEFAULT_MAX_FPS 60
+#define DEFAULT_TICK_HZ 10       // windowed mode: simulation steps per wall-clock second
+#define IDLE_WAIT_MS 500         // longest the render loop sleeps when nothing changes
+#define FRAME_HISTORY 1024       // recent frame times kept for percentiles
+#define HUD_FONT_SIZE 14
+#define HUD_SAMPLE_MS 1000       // the HUD's numbers and sparklines update once a second
+#define DEFAULT_FRAME_MS 10000   // --record: one frame per 10 simulated seconds
+#define MAX_JUNCTIONS 16384     // largest --grid, 128x128
+#define JUNCTION_SPAN WINDOW_WIDTH // world units between neighbouring junctions; one fills the window at zoom 1
+#define ZOOM_MIN 0.01f
+#define ZOOM_MAX 8.0f
+#define ZOOM_STEP 1.25f          // per wheel notch or +/- key
+#define PAN_STEP 0.1f            // fraction of the window per arrow key
+#define LOD_ZOOM 0.3f            // below this zoom queues are drawn as bars instead of vehicles
+#define LOD_QUEUE_FULL 100       // vehicles at which a queue bar spans its arm
+#define LABEL_ZOOM 0.5f          // road labels are left out below this zoom
+#define GRID_TRAVEL_MS 5000      // --grid: drive from one junction to the next; also the longest tick
+#define GRID_DEMAND 0.2          // --grid: vehicles/s starting a trip at each junction
+#define GRID_TRIP_END_PCT 25     // --grid: share of departures that end their trip instead of driving on
+#define GRID_GRAIN 16            // --grid: junctions per work-pool chunk
+#define DEFAULT_GRID_SECONDS 3600 // --grid --headless: simulated time to run
 
-// Vehicle structure
+// Shared data between threads
+// One junction's part of a snapshot
 typedef struct {
-    char id[10];
-    char road;   // A/B/C/D
-    int lane;    // 1/2/3
-} Vehicle;
+    Uint16 green;                          // green movements, MOVEMENT(road,lane) bits
+    Uint64 phaseStartMs;                   // when the current phase started
+    Uint32 queued[NUM_ROADS][NUM_LANES];   // vehicles waiting; their positions follow from queue order
+    Uint32 departed[NUM_ROADS][NUM_LANES]; // running total of departures, to animate the queue moving up
+} JunctionView;
 
-// Shared data between threads
+// Everything the renderer draws, copied out by the controller after each event.
+// The renderer reads the newest complete one through viewBuffer without locking.
+typedef struct {
+    Uint64 seq;                            // publication number, to tell a new snapshot from the last one
+    Uint64 simMs;                          // virtual time the snapshot was taken
+    int cols;                              // junctions are laid out in a grid, cols to a row
+    int count;
+    Uint64 arrivals;                       // running total, for the HUD's ingest rate
+    Uint64 decisionTicks;                  // time the controller took to pick the current phase
+                                           // (in --grid, the slowest junction's latest decision)
+    JunctionView junction[];               // sized by allocView() for the whole network
+} ViewSnapshot;
+
+ViewSnapshot* viewSnapshots[4];  // three for the triple buffer, one more so the renderer can hold two
+TripleBuffer viewBuffer;
+const ViewSnapshot* viewPrev;    // renderer-private: the two most recent snapshots it has taken
+const ViewSnapshot* viewCur;
+bool viewAnimating = false;      // the last frame was mid-way between viewPrev and viewCur
+
+// New vehicles travel from the reader thread to the controller through this ring;
+// the doorbell wakes the controller when a batch is published
+VehicleRing ingestRing;
+SDL_sem* ingestDoorbell = NULL;
+SDL_atomic_t running;
+SDL_atomic_t ingestDone;   // headless: the reader has published the whole file
+
+// --headless: no window, and simulated time jumps from phase to phase instead of sleeping
+bool headless = false;
+
+// Handoff latency and stall counters, printed at exit
+typedef struct {
+    // controller thread only
+    Uint64 handoffs;          // vehicles moved from ingestRing into the lane queues
+    Uint64 handoffTicks;      // total publish-to-drain latency
+    Uint64 handoffMaxTicks;
+    // reader thread only
+    Uint64 ringFullStalls;    // times the reader had to wait for the controller to catch up
+} PerfCounters;
+
+PerfCounters perf;
+
+// File the reader follows; the benchmark points it at generated workloads
+const char* vehicleFile = VEHICLE_FILE;
+
+// Tail-follow state for vehicleFile, owned by the reader thread
+typedef struct {
+    off_t64 offset;         // bytes consumed so far (always at a line/record boundary)
+    unsigned long long fileId; // inode on POSIX, creation time on Windows
+    bool open;
+    bool binary;            // file is a binary log (vehicle_log.h) rather than text lines
+    bool unsupported;       // binary log of a version we cannot read: ignored until truncated or replaced
+    unsigned long long records; // text records consumed, used to time-stamp them in headless mode
+} FollowState;
+
+// Totals reported at the end of a headless run
+typedef struct {
+    Uint64 phases;
+    Uint64 idleGreenMs;      // time the green movements had no vehicle to release
+    Uint64 greenMs[NUM_ROADS][NUM_LANES]; // per movement
+    Uint64 arrivals;
+    Uint64 departures;
+    Uint64 waitSumMs;        // over departed vehicles: departedMs - arrivedMs
+    Uint64 waitMaxMs;
+    size_t maxQueue;         // longest any single lane grew
+} RunStats;
+
+// Growable list of timings in performance-counter ticks, for percentiles
+typedef struct {
+    Uint64* ticks;
+    size_t count;
+    size_t capacity;
+    bool enabled;
+} LatencyLog;
+
+// The phases a junction cycles through: sets of movements that can be green together
+typedef struct {
+    int count;
+    Uint16 phase[MAX_PHASES];   // MOVEMENT(road,lane) bits
+} SignalPlan;
+
+// Growable array of vehicles in arrival order
+typedef struct {
+    Vehicle* v;
+    size_t count;
+    size_t capacity;
+} VehicleList;
+
+// What a signal policy sees when it decides: a copy of the junction's state, so a policy
+// can only change the simulation through what it returns
+typedef struct {
+    Uint64 now;
+    const SignalPlan* plan;
+    int phase;                               // index into plan of the current phase
+    Uint16 green;                            // its movements
+    Uint64 phaseStartMs;
+    Uint64 headwayMs;
+    bool started;                            // a phase has been started since the run began
+    size_t queued[NUM_ROADS][NUM_LANES];
+    size_t downstream[NUM_ROADS][NUM_LANES]; // vehicles on the road each movement discharges into
+    double arrivalRate[NUM_ROADS][NUM_LANES]; // vehicles/s, the higher of the window and EWMA estimates
+    double predicted[NUM_ROADS][NUM_LANES];  // queue expected horizonMs from now if the lights stay as they are
+    Uint64 redSinceMs[NUM_ROADS][NUM_LANES]; // when each movement last turned red
+} JunctionState;
+
+// Private state of the built-in policies; each uses the fields it needs
+typedef struct {
+    int rotation;            // next phase in the rotation
+    bool priority;           // round robin is holding the green for priorityRoad
+    int priorityRoad;
+    Uint64 priorityEntries;  // round robin: times a priority lane took over
+    Uint64 maxWaitOverrides; // round robin: phases given to a road that had been red for maxWaitMs
+} PolicyState;
+
+#define PHASE_KEEP -1        // choosePhase(): let the current phase run on
+
+// A signal-control policy. At every decision point the simulation calls observe(), then
+// choosePhase() for the phase of js->plan to turn green (restarting it if it already is) or
+// PHASE_KEEP, then chooseDuration() with that choice for the time until the next decision.
+// observe() and report() may be NULL.
+typedef struct {
+    const char* name;
+    void (*init)(PolicyState* ps);
+    void (*observe)(PolicyState* ps, const JunctionState* js);
+    int (*choosePhase)(PolicyState* ps, const JunctionState* js);
+    Uint64 (*chooseDuration)(PolicyState* ps, const JunctionState* js, int choice);
+    void (*report)(const PolicyState* ps);   // headless: extra lines for the run report
+} SignalPolicy;
+
+// Called after every event the simulation processes
+typedef void (*SimObserver)(const Event* ev);
+
+// Discrete-event simulation of one junction, owned by the thread that runs it. The live one
+// is sim; --compare runs several side by side.
+typedef struct {
+    LaneQueue lanes[NUM_ROADS][NUM_LANES]; // waiting vehicles per road (A-D) and lane (1-3)
+    RateEstimator arrivalRate[NUM_ROADS][NUM_LANES];
+    EventQueue events;
+    Uint64 now;              // virtual clock in ms; only ever moves forward
+    bool realtime;           // windowed mode: advance in fixed ticks paced by the wall clock
+    bool arrivalScheduled;   // an EV_ARRIVAL for the head of the input is pending
+    bool inputExhausted;     // headless: every vehicle in the file has arrived
+    const Vehicle* trace;    // if set, the input is this array instead of ingestRing
+    size_t traceLen;
+    size_t traceNext;
+    const SignalPolicy* policy; // NULL until the run starts = policies[0]
+    PolicyState policyState;
+    SignalPlan plan;         // built when the run starts if empty
+    int phase;               // index into plan of the current phase
+    Uint16 green;            // its movements
+    Uint64 phaseStartMs;
+    Uint64 redSinceMs[NUM_ROADS][NUM_LANES]; // when each movement last turned red
+    bool greenIdle;          // no green movement has vehicles, since idleSinceMs
+    Uint64 idleSinceMs;
+    Uint64 headwayMs;        // time between departures from one lane (1 / saturation flow)
+    bool departureScheduled[NUM_ROADS][NUM_LANES];
+    Uint32 departed[NUM_ROADS][NUM_LANES]; // running total per lane, for the view
+    Uint64 decisionTicks;    // performance-counter ticks the last decision took
+    Uint64 frameMs;          // --record: simulated ms between captured frames (0 = not recording)
+    bool viewChanged;        // an event ran since the last snapshot was published
+    Uint64 viewSeq;
+    SimObserver observers[MAX_OBSERVERS];
+    int observerCount;
+    RunStats stats;
+    LatencyLog waits;        // --compare: every vehicle's delay, in ms rather than ticks
+    VehicleList* outbox[NUM_ROADS]; // --grid: departures bound for the neighbour at each arm
+                             // position clockwise from the top; NULL = they leave the network
+    const size_t* exitQueue[NUM_ROADS]; // --grid: that neighbour's mean lane queue, last tick, on the arm we enter
+    Uint64 rng;              // --grid: turns at the next junction and trip ends
+} Simulation;
+
+Simulation sim;
+
+// One junction of the --grid network
+typedef struct {
+    Simulation sim;
+    int col, row;
+    VehicleList out[2][NUM_ROADS]; // departures for each neighbour, by tick parity and arm position
+    VehicleList inbox;       // vehicles on their way here, in arrival order; sim.trace points into it
+    VehicleList starting;    // scratch for collectArrivals(): trips starting here this tick
+    size_t armQueued[2][NUM_ROADS]; // mean lane queue of each arm at the end of a tick, by tick parity and arm position
+    Uint64 nextTripMs;       // when the next trip starts here
+    Uint64 trips;
+} GridJunction;
+
+// --grid: a cols x rows network stepped in ticks on a work pool
 typedef struct {
-    int currentGreen;    // 0=A,1=B,2=C,3=D
-    int counts[4];       // number of vehicles waiting in priority lane (lane 2)
-    SDL_mutex* mutex;
-} SharedData;
+    int cols, rows;          // 0 = the single junction
+    int count;
+    int threads;             // --threads
+    double demand;           // --demand: trips starting per junction per second
+    Uint64 durationMs;       // --duration, headless
+    Uint64 tripGapMs;        // mean time between trips at a junction
+    GridJunction* junction;  // row by row
+    WorkPool pool;
+    int parity;              // which out[] set this tick writes; the other is collected
+    Uint64 tickStartMs, tickEndMs;
+    Uint64 ticks;
+    ViewSnapshot* view;      // windowed: the back snapshot this tick fills in
+} Grid;
+
+Grid grid;
+Uint64 simEpochMs = 0;       // SDL_GetTicks64() at virtual time 0 in windowed mode
+double simSpeed = 1.0;       // windowed mode: virtual ms per wall-clock ms (--speed)
+int tickHz = DEFAULT_TICK_HZ;
+
+// Policy parameters, read by every simulation
+Uint64 minGreenMs = DEFAULT_MIN_GREEN_MS;   // --min-green
+Uint64 maxWaitMs = DEFAULT_MAX_WAIT_MS;     // --max-wait
+Uint64 maxGreenMs = DEFAULT_MAX_GREEN_MS;   // --max-green
+Uint64 horizonMs = DEFAULT_HORIZON_MS;      // --horizon
+bool roadPhases = false;                    // --phases road: one road per phase instead of the derived plan
+
+// Windowed mode: the virtual time the wall clock has reached
+static inline Uint64 virtualNowMs(){
+    return (Uint64)((SDL_GetTicks64()-simEpochMs)*simSpeed);
+}
 
-SharedData sharedData;
+// Windowed mode: virtual ms covered by one simulation tick. A --grid tick cannot outrun the
+// travel time between junctions.
+static inline Uint64 tickStepMs(){
+    Uint64 step = (Uint64)(1000.0*simSpeed/tickHz);
+    if(grid.cols && step>GRID_TRAVEL_MS) step = GRID_TRAVEL_MS;
+    return step ? step : 1;
+}
+
+LatencyLog decisionLog;      // time spent choosing each phase (filled only by --bench)
+
+// The render loop sleeps until the simulation changes something visible. The controller
+// sets viewDirty and, on the clean-to-dirty edge only, pushes a wakeEvent so a burst of
+// changes costs one SDL event.
+SDL_atomic_t viewDirty;
+Uint32 wakeEvent = (Uint32)-1;
+int maxFps = DEFAULT_MAX_FPS;   // 0 = limited by vsync only
+
+// Frame times measured by the render loop, printed at exit
+typedef struct {
+    Uint64 ticks[FRAME_HISTORY]; // refreshScreen() durations, a ring of the most recent frames
+    Uint64 frames;
+    Uint64 totalTicks;
+    Uint64 wakeups;              // render loop iterations, presented or not
+} FrameStats;
 
-// Vehicle queue
-Vehicle vehicleQueue[MAX_VEHICLES];
-int vehicleCount = 0;
+FrameStats frameStats;
 
 // SDL objects
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
 TTF_Font* font = NULL;
+TextCache textCache;         // labels rendered with font, reused across frames
+TTF_Font* hudFont = NULL;
+TextCache hudText;           // single characters in hudFont, so changing numbers allocate nothing
+
+// Performance overlay, toggled with H or F1. Sampled once a second whether shown or not,
+// so the sparklines already hold a minute of history when it is switched on.
+typedef struct {
+    bool visible;
+    Uint64 lastSampleMs;     // SDL_GetTicks64() of the last sample
+    Uint64 lastFrames, lastArrivals;
+    double fps, frameP50Ms, frameP99Ms, ingestVps, decisionUs;
+    int junctions;           // decisionUs is the slowest of this many
+    Uint32 queued[NUM_ROADS][NUM_LANES];
+    Sparkline fpsLine, queuedLine, ingestLine, decisionLine;
+} Hud;
+
+Hud hud;
+
+// Quads for every drawn vehicle, submitted in one SDL_RenderGeometry call.
+// Kept across frames and only grown, so a steady frame allocates nothing.
+typedef struct {
+    SDL_Vertex* vertices;    // 4 per vehicle
+    int* indices;            // 6 per vehicle, two triangles; fixed pattern filled when grown
+    size_t capacity;         // vehicles
+} VehicleBatch;
+
+VehicleBatch vehicleBatch;
+
+// Roads, lane lines and labels never change, so they are drawn once into this
+// target texture and blitted at the start of each frame
+SDL_Texture* background = NULL;
+bool backgroundDirty = true;  // redraw before the next frame (window resized, targets lost)
+
+// Maps world coordinates to the WINDOW_WIDTH x WINDOW_HEIGHT logical screen. Junction j's
+// bounding box is the JUNCTION_SPAN square at column j%cols, row j/cols. Render thread only.
+typedef struct {
+    float x, y;              // world point at the top-left corner of the screen
+    float zoom;              // screen px per world unit
+    bool fitted;             // false: fit the whole network on the next frame
+    bool dragging;
+    int mouseX, mouseY;      // last mouse position, logical coordinates
+} Camera;
+
+Camera camera;
 
 // Function declarations
 bool initSDL();
-void drawRoads();
-void drawLights();
+void drawRoads(float x, float y, float zoom);
+void drawRoadLabels(float x, float y, float zoom);
+bool drawJunctions(const ViewSnapshot* prev, const ViewSnapshot* cur, float alpha, Uint64 shownMs);
+bool handleCameraEvent(const SDL_Event* event);
+void invalidateBackground(bool lost);
+bool sampleHud();
+void drawHud();
+void freeVehicleBatch();
 void drawText(const char* text, int x, int y);
-DWORD WINAPI readVehicles(LPVOID arg);
-DWORD WINAPI manageLights(LPVOID arg);
+int readVehicles(void* arg);
+int manageLights(void* arg);
+int manageGrid(void* arg);
 void refreshScreen();
-int getPriorityRoad();
+static bool allocView(int junctions);
+static void freeView();
+static void resetView();
+void printPerfCounters();
+void runHeadless();
+static bool parseFlow(const char* arg);
+static bool parseController(const char* arg);
+static bool parsePhases(const char* arg);
+static bool parseGrid(const char* arg);
+static bool initGrid(Grid* g);
+static void freeGrid(Grid* g);
+static void runGridHeadless(Grid* g);
+static void freeSimulation(Simulation* s);
+static void forwardVehicle(Simulation* s, const Vehicle* v);
+static Uint64 benchRandom(Uint64* state);
+static void benchPlate(Uint64* rng, char* plate);
+void addObserver(SimObserver fn);
+void markViewDirty();
+int runBenchmarks(int argc, char* argv[]);
+int runComparison(int argc, char* argv[]);
+int runRecording(const char* dir, bool raw);
 
 int main(int argc, char* argv[]) {
-    if (!initSDL()) return -1;
+    if(argc>1 && strcmp(argv[1],"--bench")==0) return runBenchmarks(argc-2,argv+2);
+    if(argc>1 && strcmp(argv[1],"--compare")==0) return runComparison(argc-2,argv+2);
+    sim.headwayMs = (Uint64)(1000/DEFAULT_FLOW);
+    grid.threads = SDL_GetCPUCount();
+    grid.demand = GRID_DEMAND;
+    grid.durationMs = DEFAULT_GRID_SECONDS*1000ULL;
+    const char* recordDir = NULL;
+    bool recordRaw = false;
+    for(int i=1;i<argc;i++){
+        if(strcmp(argv[i],"--headless")==0) headless = true;
+        else if(strcmp(argv[i],"--record")==0 && i+1<argc){ recordDir = argv[++i]; headless = true; }
+        else if(strcmp(argv[i],"--frame-ms")==0 && i+1<argc && atoi(argv[i+1])>0) sim.frameMs = (Uint64)atoi(argv[++i]);
+        else if(strcmp(argv[i],"--raw")==0) recordRaw = true;
+        else if(strcmp(argv[i],"--flow")==0 && i+1<argc && parseFlow(argv[i+1])) i++;
+        else if(strcmp(argv[i],"--controller")==0 && i+1<argc && parseController(argv[i+1])) i++;
+        else if(strcmp(argv[i],"--phases")==0 && i+1<argc && parsePhases(argv[i+1])) i++;
+        else if(strcmp(argv[i],"--min-green")==0 && i+1<argc && atoi(argv[i+1])>0) minGreenMs = (Uint64)atoi(argv[++i]);
+        else if(strcmp(argv[i],"--max-wait")==0 && i+1<argc && atoi(argv[i+1])>0) maxWaitMs = (Uint64)atoi(argv[++i]);
+        else if(strcmp(argv[i],"--max-green")==0 && i+1<argc && atoi(argv[i+1])>0) maxGreenMs = (Uint64)atoi(argv[++i]);
+        else if(strcmp(argv[i],"--horizon")==0 && i+1<argc && atoi(argv[i+1])>=0) horizonMs = (Uint64)atoi(argv[++i]);
+        else if(strcmp(argv[i],"--max-fps")==0 && i+1<argc) maxFps = atoi(argv[++i]);
+        else if(strcmp(argv[i],"--speed")==0 && i+1<argc && atof(argv[i+1])>0) simSpeed = atof(argv[++i]);
+        else if(strcmp(argv[i],"--tick-hz")==0 && i+1<argc && atoi(argv[i+1])>0) tickHz = atoi(argv[++i]);
+        else if(strcmp(argv[i],"--grid")==0 && i+1<argc && parseGrid(argv[i+1])) i++;
+        else if(strcmp(argv[i],"--threads")==0 && i+1<argc && atoi(argv[i+1])>0) grid.threads = atoi(argv[++i]);
+        else if(strcmp(argv[i],"--demand")==0 && i+1<argc && atof(argv[i+1])>0) grid.demand = atof(argv[++i]);
+        else if(strcmp(argv[i],"--duration")==0 && i+1<argc && atoi(argv[i+1])>0) grid.durationMs = (Uint64)atoi(argv[++i])*1000;
+        else {
+            fprintf(stderr,"usage: %s [--headless] [--flow vehicles_per_s_per_lane] [--max-fps n]\n"
+                           "          [--speed multiplier] [--tick-hz n]\n"
+                           "          [--controller round-robin|fixed-time|queue-proportional|max-pressure]\n"
+                           "          [--phases movement|road]\n"
+                           "          [--grid COLSxROWS [--threads n] [--demand trips_per_s] [--duration s]]\n"
+                           "          [--min-green ms] [--max-green ms] [--max-wait ms] [--horizon ms]\n"
+                           "       %s --record dir [--frame-ms simulated_ms] [--raw] [--flow ...]\n"
+                           "       %s --bench [workloads] [--format json|csv] [--controller ...] [--phases ...]\n"
+                           "          [--min-green ms] [--max-green ms]\n"
+                           "       %s --compare [workload|file] [--flow ...] [--phases ...] [--min-green ms] [--max-green ms] [--max-wait ms] [--horizon ms]\n",
+                    argv[0],argv[0],argv[0],argv[0]);
+            return 2;
+        }
+    }
+    if(grid.cols && recordDir){ fprintf(stderr,"--record captures a single junction; leave out --grid\n"); return 2; }
+    if (!headless && !initSDL()) return -1;
 
     SDL_Event event;
-    bool running = true;
 
     // Initialize shared data
-    sharedData.currentGreen = 0;
-    for(int i=0;i<4;i++) sharedData.counts[i]=0;
-    sharedData.mutex = SDL_CreateMutex();
+    if(!allocView(grid.cols && !headless ? grid.cols*grid.rows : 1)){ SDL_Log("Out of memory for the view"); return -1; }
+    resetView();
+    if(!ringInit(&ingestRing)){ SDL_Log("Out of memory for the ingest ring"); return -1; }
+    ingestDoorbell = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&running,1);
+    simEpochMs = SDL_GetTicks64();
 
-    // Start threads
-    HANDLE hReadThread = CreateThread(NULL,0,readVehicles,NULL,0,NULL);
-    HANDLE hLightThread = CreateThread(NULL,0,manageLights,NULL,0,NULL);
+    // Start threads. A grid generates its own traffic and runs on a work pool instead of the
+    // controller thread alone.
+    SDL_Thread* hReadThread = NULL;
+    if(grid.cols){
+        if(!initGrid(&grid)){ SDL_Log("Out of memory for a %dx%d grid", grid.cols, grid.rows); return -1; }
+        if(headless){
+            runGridHeadless(&grid);
+            freeGrid(&grid);
+            return 0;
+        }
+    }
+    else hReadThread = SDL_CreateThread(readVehicles,"readVehicles",NULL);
+    if(headless){
+        int status = 0;
+        if(recordDir) status = runRecording(recordDir,recordRaw);
+        else runHeadless();
+        SDL_WaitThread(hReadThread, NULL);
+        printPerfCounters();
+        return status;
+    }
+    SDL_Thread* hLightThread = grid.cols ? SDL_CreateThread(manageGrid,"manageGrid",NULL)
+                                         : SDL_CreateThread(manageLights,"manageLights",NULL);
 
-    while(running) {
-        while(SDL_PollEvent(&event)) {
-            if(event.type == SDL_QUIT) running = false;
+    // Redraw only when something changed, at most maxFps times a second; presents are vsync-paced
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 minFrameTicks = maxFps>0 ? freq/maxFps : 0;
+    Uint64 lastFrame = 0;
+    bool dirty = true;
+    while(SDL_AtomicGet(&running)) {
+        int timeout = IDLE_WAIT_MS;
+        if(dirty){
+            Uint64 now = SDL_GetPerformanceCounter();
+            Uint64 due = lastFrame + minFrameTicks;
+            timeout = due>now ? (int)((due-now)*1000/freq) + 1 : 0;
+        }
+        if(SDL_WaitEventTimeout(&event,timeout)){
+            do {
+                if(event.type == SDL_QUIT) SDL_AtomicSet(&running,0);
+                else if(event.type == SDL_RENDER_DEVICE_RESET){ // every texture was lost
+                    tcClear(&textCache);
+                    tcClear(&hudText);
+                    invalidateBackground(true);
+                    dirty = true;
+                }
+                else if(event.type == SDL_RENDER_TARGETS_RESET){ invalidateBackground(false); dirty = true; }
+                else if(event.type == SDL_WINDOWEVENT){
+                    if(event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) invalidateBackground(false);
+                    if(event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_EXPOSED)
+                        dirty = true;
+                }
+                else if(event.type == SDL_KEYDOWN && !event.key.repeat &&
+                        (event.key.keysym.sym == SDLK_h || event.key.keysym.sym == SDLK_F1)){
+                    hud.visible = !hud.visible;
+                    dirty = true;
+                }
+                else if(handleCameraEvent(&event)) dirty = true;
+            } while(SDL_PollEvent(&event)); // wakeEvent needs no handling: it only ends the wait
         }
+        frameStats.wakeups++;
+        if(sampleHud() && hud.visible) dirty = true;
+        if(SDL_AtomicSet(&viewDirty,0)) dirty = true;
+        Uint64 f0 = SDL_GetPerformanceCounter();
+        if(!dirty || !SDL_AtomicGet(&running) || f0-lastFrame < minFrameTicks) continue;
         refreshScreen();
-        SDL_Delay(50); // 20 FPS
+        Uint64 spent = SDL_GetPerformanceCounter()-f0;
+        frameStats.ticks[frameStats.frames % FRAME_HISTORY] = spent;
+        frameStats.frames++;
+        frameStats.totalTicks += spent;
+        lastFrame = f0;
+        dirty = viewAnimating; // keep drawing until the interpolation catches up
     }
 
-    WaitForSingleObject(hReadThread, INFINITE);
-    WaitForSingleObject(hLightThread, INFINITE);
+    SDL_SemPost(ingestDoorbell); // wake the controller so it notices the shutdown
+    SDL_WaitThread(hReadThread, NULL);
+    SDL_WaitThread(hLightThread, NULL);
+    printPerfCounters();
 
-    SDL_DestroyMutex(sharedData.mutex);
+    SDL_DestroySemaphore(ingestDoorbell);
+    ringFree(&ingestRing);
+    freeSimulation(&sim);
+    if(grid.cols) freeGrid(&grid);
+    freeView();
+    tcFree(&textCache);
+    tcFree(&hudText);
+    freeVehicleBatch();
+    invalidateBackground(true);
     if(font) TTF_CloseFont(font);
+    if(hudFont) TTF_CloseFont(hudFont);
     if(renderer) SDL_DestroyRenderer(renderer);
     if(window) SDL_DestroyWindow(window);
     TTF_Quit();
@@ -88,126 +578,2357 @@ bool initSDL() {
     if(TTF_Init() <0) { SDL_Log("TTF Init failed: %s",TTF_GetError()); return false; }
 
     window = SDL_CreateWindow("Traffic Junction", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                              WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+                              WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
     if(!window){ SDL_Log("Window failed: %s", SDL_GetError()); return false; }
 
-    renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if(!renderer){ SDL_Log("Renderer failed: %s",SDL_GetError()); return false; }
+    SDL_RenderSetLogicalSize(renderer,WINDOW_WIDTH,WINDOW_HEIGHT); // the layout scales with the window
 
     font = TTF_OpenFont(MAIN_FONT,24);
     if(!font){ SDL_Log("Font failed: %s",TTF_GetError()); return false; }
+    tcInit(&textCache,renderer,font);
+    hudFont = TTF_OpenFont(MAIN_FONT,HUD_FONT_SIZE);
+    tcInit(&hudText,renderer,hudFont);
+    hud.lastSampleMs = SDL_GetTicks64();
+    wakeEvent = SDL_RegisterEvents(1);
 
     return true;
 }
 
-void drawRoads() {
+// Road surface and lane lines of one junction whose tile has its top-left corner at
+// screen (x, y), scaled by zoom
+void drawRoads(float x, float y, float zoom) {
     SDL_SetRenderDrawColor(renderer, 200,200,200,255);
-    SDL_Rect vertical = {WINDOW_WIDTH/2 - ROAD_WIDTH/2, 0, ROAD_WIDTH, WINDOW_HEIGHT};
-    SDL_Rect horizontal = {0, WINDOW_HEIGHT/2 - ROAD_WIDTH/2, WINDOW_WIDTH, ROAD_WIDTH};
-    SDL_RenderFillRect(renderer, &vertical);
-    SDL_RenderFillRect(renderer, &horizontal);
+    SDL_FRect vertical = {x + (WINDOW_WIDTH/2 - ROAD_WIDTH/2)*zoom, y, ROAD_WIDTH*zoom, WINDOW_HEIGHT*zoom};
+    SDL_FRect horizontal = {x, y + (WINDOW_HEIGHT/2 - ROAD_WIDTH/2)*zoom, WINDOW_WIDTH*zoom, ROAD_WIDTH*zoom};
+    SDL_RenderFillRectF(renderer, &vertical);
+    SDL_RenderFillRectF(renderer, &horizontal);
 
     SDL_SetRenderDrawColor(renderer,0,0,0,255);
     for(int i=0;i<=3;i++){
+        float across = (WINDOW_HEIGHT/2 - ROAD_WIDTH/2 + LANE_WIDTH*i)*zoom;
+        float near = (WINDOW_WIDTH/2 - ROAD_WIDTH/2)*zoom, far = (WINDOW_WIDTH/2 + ROAD_WIDTH/2)*zoom;
         // horizontal lanes
-        SDL_RenderDrawLine(renderer,0,WINDOW_HEIGHT/2 - ROAD_WIDTH/2 + LANE_WIDTH*i, WINDOW_WIDTH/2 - ROAD_WIDTH/2, WINDOW_HEIGHT/2 - ROAD_WIDTH/2 + LANE_WIDTH*i);
-        SDL_RenderDrawLine(renderer,WINDOW_WIDTH,WINDOW_HEIGHT/2 - ROAD_WIDTH/2 + LANE_WIDTH*i, WINDOW_WIDTH/2 + ROAD_WIDTH/2, WINDOW_HEIGHT/2 - ROAD_WIDTH/2 + LANE_WIDTH*i);
+        SDL_RenderDrawLineF(renderer, x, y+across, x+near, y+across);
+        SDL_RenderDrawLineF(renderer, x+WINDOW_WIDTH*zoom, y+across, x+far, y+across);
         // vertical lanes
-        SDL_RenderDrawLine(renderer, WINDOW_WIDTH/2 - ROAD_WIDTH/2 + LANE_WIDTH*i,0, WINDOW_WIDTH/2 - ROAD_WIDTH/2 + LANE_WIDTH*i, WINDOW_HEIGHT/2 - ROAD_WIDTH/2);
-        SDL_RenderDrawLine(renderer, WINDOW_WIDTH/2 - ROAD_WIDTH/2 + LANE_WIDTH*i,WINDOW_HEIGHT, WINDOW_WIDTH/2 - ROAD_WIDTH/2 + LANE_WIDTH*i, WINDOW_HEIGHT/2 + ROAD_WIDTH/2);
+        SDL_RenderDrawLineF(renderer, x+across, y, x+across, y+near);
+        SDL_RenderDrawLineF(renderer, x+across, y+WINDOW_HEIGHT*zoom, x+across, y+far);
     }
 
-    drawText("A", WINDOW_WIDTH/2, 10);
-    drawText("B", WINDOW_WIDTH/2, WINDOW_HEIGHT - 40);
-    drawText("C", WINDOW_WIDTH - 40, WINDOW_HEIGHT/2);
-    drawText("D", 10, WINDOW_HEIGHT/2);
 }
 
-void drawLights() {
-    SDL_Rect rect = {WINDOW_WIDTH/2 - 25, WINDOW_HEIGHT/2 - 25, 50, 50};
-    for(int i=0;i<4;i++){
-        if(sharedData.currentGreen==i) SDL_SetRenderDrawColor(renderer,0,255,0,255);
-        else SDL_SetRenderDrawColor(renderer,255,0,0,255);
-        switch(i){
-            case 0: rect.x = WINDOW_WIDTH/2 -25; rect.y=10; break;   // A top
-            case 1: rect.x = WINDOW_WIDTH/2 -25; rect.y=WINDOW_HEIGHT-60; break; // B bottom
-            case 2: rect.x = WINDOW_WIDTH-60; rect.y=WINDOW_HEIGHT/2 -25; break; // C right
-            case 3: rect.x =10; rect.y=WINDOW_HEIGHT/2 -25; break; // D left
+// Road names of the junction at screen (x, y). Kept out of the prerendered tile so that they
+// stay at font size whatever the zoom.
+void drawRoadLabels(float x, float y, float zoom) {
+    if(zoom<LABEL_ZOOM) return;   // labels are not scaled, so they would cover a small junction
+    drawText("A", (int)(x + WINDOW_WIDTH/2*zoom), (int)(y + 10*zoom));
+    drawText("B", (int)(x + WINDOW_WIDTH/2*zoom), (int)(y + (WINDOW_HEIGHT - 40)*zoom));
+    drawText("C", (int)(x + (WINDOW_WIDTH - 40)*zoom), (int)(y + WINDOW_HEIGHT/2*zoom));
+    drawText("D", (int)(x + 10*zoom), (int)(y + WINDOW_HEIGHT/2*zoom));
+}
+
+// Show the whole network, centred
+static void fitCamera(const ViewSnapshot* view){
+    int cols = view->cols>0 ? view->cols : 1;
+    int rows = view->count>0 ? (view->count+cols-1)/cols : 1;
+    float zx = (float)WINDOW_WIDTH/(cols*JUNCTION_SPAN), zy = (float)WINDOW_HEIGHT/(rows*JUNCTION_SPAN);
+    camera.zoom = zx<zy ? zx : zy;
+    if(camera.zoom>1) camera.zoom = 1;
+    camera.x = (cols*JUNCTION_SPAN - WINDOW_WIDTH/camera.zoom)/2;
+    camera.y = (rows*JUNCTION_SPAN - WINDOW_HEIGHT/camera.zoom)/2;
+    camera.fitted = true;
+}
+
+// Zoom by factor, keeping the world point under screen position (sx, sy) where it is
+static void zoomCamera(float factor, float sx, float sy){
+    float zoom = camera.zoom*factor;
+    if(zoom<ZOOM_MIN) zoom = ZOOM_MIN;
+    if(zoom>ZOOM_MAX) zoom = ZOOM_MAX;
+    camera.x += sx/camera.zoom - sx/zoom;
+    camera.y += sy/camera.zoom - sy/zoom;
+    camera.zoom = zoom;
+}
+
+static void panCamera(float dx, float dy){
+    camera.x -= dx/camera.zoom;
+    camera.y -= dy/camera.zoom;
+}
+
+// Drag with the left button or use the arrow keys to pan; wheel or +/- to zoom, Home or 0 to
+// see everything. Returns true if the view moved.
+bool handleCameraEvent(const SDL_Event* event){
+    switch(event->type){
+        case SDL_MOUSEBUTTONDOWN:
+            if(event->button.button==SDL_BUTTON_LEFT) camera.dragging = true;
+            camera.mouseX = event->button.x;
+            camera.mouseY = event->button.y;
+            return false;
+        case SDL_MOUSEBUTTONUP:
+            if(event->button.button==SDL_BUTTON_LEFT) camera.dragging = false;
+            return false;
+        case SDL_MOUSEMOTION: {
+            // positions rather than xrel/yrel: they are already in logical coordinates
+            int dx = event->motion.x-camera.mouseX, dy = event->motion.y-camera.mouseY;
+            camera.mouseX = event->motion.x;
+            camera.mouseY = event->motion.y;
+            if(!camera.dragging || (dx==0 && dy==0)) return false;
+            panCamera((float)dx,(float)dy);
+            return true;
         }
-        SDL_RenderFillRect(renderer,&rect);
+        case SDL_MOUSEWHEEL:
+            if(event->wheel.y==0) return false;
+            zoomCamera(SDL_powf(ZOOM_STEP,(float)event->wheel.y),(float)camera.mouseX,(float)camera.mouseY);
+            return true;
+        case SDL_KEYDOWN:
+            switch(event->key.keysym.sym){
+                case SDLK_LEFT:  panCamera(WINDOW_WIDTH*PAN_STEP,0); return true;
+                case SDLK_RIGHT: panCamera(-WINDOW_WIDTH*PAN_STEP,0); return true;
+                case SDLK_UP:    panCamera(0,WINDOW_HEIGHT*PAN_STEP); return true;
+                case SDLK_DOWN:  panCamera(0,-WINDOW_HEIGHT*PAN_STEP); return true;
+                case SDLK_PLUS: case SDLK_EQUALS: case SDLK_KP_PLUS:
+                    zoomCamera(ZOOM_STEP,WINDOW_WIDTH/2.0f,WINDOW_HEIGHT/2.0f); return true;
+                case SDLK_MINUS: case SDLK_KP_MINUS:
+                    zoomCamera(1/ZOOM_STEP,WINDOW_WIDTH/2.0f,WINDOW_HEIGHT/2.0f); return true;
+                case SDLK_HOME: case SDLK_0:
+                    camera.fitted = false; return true;
+            }
+            return false;
     }
+    return false;
 }
 
-void drawText(const char* text, int x, int y){
-    SDL_Color color = {0,0,0,255};
-    SDL_Surface* surf = TTF_RenderText_Solid(font,text,color);
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer,surf);
-    SDL_Rect dst = {x,y,0,0};
-    SDL_QueryTexture(tex,NULL,NULL,&dst.w,&dst.h);
-    SDL_RenderCopy(renderer,tex,NULL,&dst);
-    SDL_FreeSurface(surf);
-    SDL_DestroyTexture(tex);
+// First and last index of the tiles of size JUNCTION_SPAN, out of n, that overlap the world
+// interval [from, to). Computed in float so a camera far off the network cannot overflow.
+static bool visibleRange(float from, float to, int n, int* first, int* last){
+    float a = SDL_floorf(from/JUNCTION_SPAN), b = SDL_ceilf(to/JUNCTION_SPAN)-1;
+    if(b<0 || a>=n) return false;
+    *first = a<0 ? 0 : (int)a;
+    *last = b>=n ? n-1 : (int)b;
+    return true;
 }
 
-DWORD WINAPI readVehicles(LPVOID arg){
-    while(1){
-        FILE* file = fopen(VEHICLE_FILE,"r");
-        if(!file){ Sleep(2000); continue; }
-
-        SDL_LockMutex(sharedData.mutex);
-        vehicleCount=0;
-        for(int i=0;i<4;i++) sharedData.counts[i]=0;
-
-        char line[50];
-        while(fgets(line,sizeof(line),file) && vehicleCount<MAX_VEHICLES){
-            line[strcspn(line,"\n")]=0;
-            Vehicle v;
-            if(sscanf(line,"%c %d %s",&v.road,&v.lane,v.id)==3){
-                vehicleQueue[vehicleCount++] = v;
-                if(v.lane==2){ // priority lane
-                    int idx = v.road-'A';
-                    if(idx>=0 && idx<4) sharedData.counts[idx]++;
-                }
+// Columns [*c0, *c1] and rows [*r0, *r1] of the junctions whose bounding boxes intersect the
+// screen. The junctions form a grid, so this is a division rather than a test of every box,
+// and drawing costs the same however large the network is.
+static bool visibleJunctions(const ViewSnapshot* view, int* c0, int* c1, int* r0, int* r1){
+    if(view->count<=0 || view->cols<=0) return false;
+    int rows = (view->count+view->cols-1)/view->cols;
+    return visibleRange(camera.x,camera.x+WINDOW_WIDTH/camera.zoom,view->cols,c0,c1) &&
+           visibleRange(camera.y,camera.y+WINDOW_HEIGHT/camera.zoom,rows,r0,r1);
+}
+
+// Screen position of the top-left corner of junction (col, row)
+static inline void junctionOrigin(int col, int row, float* x, float* y){
+    *x = ((float)col*JUNCTION_SPAN - camera.x)*camera.zoom;
+    *y = ((float)row*JUNCTION_SPAN - camera.y)*camera.zoom;
+}
+
+// Queue layout per road: the stop-line corner of lane 1, the direction the queue
+// grows (away from the junction) and the direction across its lanes
+static const struct { int x, y, ax, ay, cx, cy; } arms[NUM_ROADS] = {
+    {WINDOW_WIDTH/2 - ROAD_WIDTH/2, WINDOW_HEIGHT/2 - ROAD_WIDTH/2,  0,-1, 1,0}, // A top
+    {WINDOW_WIDTH/2 - ROAD_WIDTH/2, WINDOW_HEIGHT/2 + ROAD_WIDTH/2,  0, 1, 1,0}, // B bottom
+    {WINDOW_WIDTH/2 + ROAD_WIDTH/2, WINDOW_HEIGHT/2 - ROAD_WIDTH/2,  1, 0, 0,1}, // C right
+    {WINDOW_WIDTH/2 - ROAD_WIDTH/2, WINDOW_HEIGHT/2 - ROAD_WIDTH/2, -1, 0, 0,1}, // D left
+};
+
+// Top-left corner of each road's light
+static const SDL_Point lights[NUM_ROADS] = {
+    {WINDOW_WIDTH/2 - 25, 10},                // A top
+    {WINDOW_WIDTH/2 - 25, WINDOW_HEIGHT - 60}, // B bottom
+    {WINDOW_WIDTH - 60, WINDOW_HEIGHT/2 - 25}, // C right
+    {10, WINDOW_HEIGHT/2 - 25},               // D left
+};
+
+static const SDL_Color laneColors[NUM_LANES] = {{40,90,200,255},{230,130,20,255},{130,60,170,255}};
+
+static bool growVehicleBatch(VehicleBatch* b, size_t vehicles){
+    if(vehicles<=b->capacity) return true;
+    size_t cap = b->capacity ? b->capacity : 1024;
+    while(cap<vehicles) cap *= 2;
+    SDL_Vertex* v = (SDL_Vertex*)realloc(b->vertices,cap*4*sizeof(SDL_Vertex));
+    if(!v) return false;
+    b->vertices = v;
+    int* idx = (int*)realloc(b->indices,cap*6*sizeof(int));
+    if(!idx) return false;
+    b->indices = idx;
+    for(size_t i=b->capacity;i<cap;i++){
+        int q = (int)(i*4);
+        int* t = idx + i*6;
+        t[0]=q; t[1]=q+1; t[2]=q+2; t[3]=q+2; t[4]=q+3; t[5]=q;
+    }
+    b->capacity = cap;
+    return true;
+}
+
+void freeVehicleBatch(){
+    free(vehicleBatch.vertices);
+    free(vehicleBatch.indices);
+    memset(&vehicleBatch,0,sizeof(vehicleBatch));
+}
+
+// Quad n of the batch, corners (x0, y0) and (x1, y1) in screen coordinates
+static inline void setQuad(size_t n, float x0, float y0, float x1, float y1, SDL_Color color){
+    SDL_Vertex* q = vehicleBatch.vertices + n*4;
+    q[0].position.x = x0; q[0].position.y = y0;
+    q[1].position.x = x1; q[1].position.y = y0;
+    q[2].position.x = x1; q[2].position.y = y1;
+    q[3].position.x = x0; q[3].position.y = y1;
+    for(int k=0;k<4;k++){ q[k].color = color; q[k].tex_coord.x = q[k].tex_coord.y = 0; }
+}
+
+// Offset of queue slot p (0 = first in line; fractional while moving up) along the arm and
+// across its lane, interpolating between the cells on either side. Slots are filled a row
+// of cols at a time; negative slots are past the stop line, inside the junction.
+static void slotOffset(float p, int cols, int cell, float* along, float* across){
+    float k = SDL_floorf(p), f = p-k;
+    float pos[2][2];
+    for(int j=0;j<2;j++){
+        long i = (long)k + j;
+        long row = i>=0 ? i/cols : -((-i+cols-1)/cols);
+        pos[j][0] = (float)(row*cell);
+        pos[j][1] = (float)((i-row*cols)*cell);
+    }
+    *along = pos[0][0] + (pos[1][0]-pos[0][0])*f;
+    *across = pos[0][1] + (pos[1][1]-pos[0][1])*f;
+}
+
+// Append every queued vehicle of one junction, its tile at screen (x, y), as a square on its
+// lane with the front of the queue at the stop line. Positions depend only on queue order, so
+// the queue lengths are all it needs. Between two snapshots each lane moves up by the vehicles
+// that departed in between, alpha of the way (0 = as in prev, 1 = as in cur), while the
+// departed ones drive into the junction. One cell size is used for the whole junction, the
+// largest that still fits the longest queue on its arm. Returns the new quad count.
+static size_t addVehicles(const JunctionView* prev, const JunctionView* cur, float alpha, float x, float y, size_t n){
+    size_t longest = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(cur->queued[r][l]>longest) longest = cur->queued[r][l];
+    int cell = VEHICLE_CELL_MAX;
+    while(cell>VEHICLE_CELL_MIN && (size_t)(LANE_WIDTH/cell)*(ARM_LENGTH/cell)<longest) cell--;
+    int cols = LANE_WIDTH/cell;
+    size_t fit = (size_t)cols*(ARM_LENGTH/cell);
+    size_t crossing = (size_t)cols*(ROAD_WIDTH/cell); // slots between the stop line and the far side
+    float size = cell>=4 ? cell-1 : cell;   // keep a 1 px gap while vehicles are big enough to show it
+    int margin = (LANE_WIDTH - cols*cell)/2;
+    float zoom = camera.zoom;
+
+    size_t counts[NUM_ROADS][NUM_LANES], moved[NUM_ROADS][NUM_LANES], total = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++){
+            Uint32 d = cur->departed[r][l]-prev->departed[r][l];
+            moved[r][l] = alpha<1 && cur->departed[r][l]>=prev->departed[r][l] ? d : 0;
+            counts[r][l] = cur->queued[r][l]<fit ? cur->queued[r][l] : fit;
+            total += counts[r][l] + (moved[r][l]<crossing ? moved[r][l] : crossing);
+        }
+    if(total==0 || !growVehicleBatch(&vehicleBatch,n+total)) return n;
+
+    for(int r=0;r<NUM_ROADS;r++){
+        float dx = (arms[r].ax+arms[r].cx)*size*zoom, dy = (arms[r].ay+arms[r].cy)*size*zoom;
+        for(int l=0;l<NUM_LANES;l++){
+            float shift = moved[r][l]*(1-alpha);
+            long first = -(long)(moved[r][l]<crossing ? moved[r][l] : crossing);
+            for(long i=first;i<(long)counts[r][l];i++){
+                float p = i + shift, along, across;
+                if(p>=(float)fit) break;
+                slotOffset(p,cols,cell,&along,&across);
+                across += l*LANE_WIDTH + margin;
+                float x0 = x + (arms[r].x + arms[r].ax*along + arms[r].cx*across)*zoom;
+                float y0 = y + (arms[r].y + arms[r].ay*along + arms[r].cy*across)*zoom;
+                setQuad(n++,x0,y0,x0+dx,y0+dy,laneColors[l]);
             }
         }
-        SDL_UnlockMutex(sharedData.mutex);
-        fclose(file);
-        Sleep(1000);
     }
+    return n;
+}
+
+// Zoomed-out level of detail: one bar per lane instead of its vehicles, running from the stop
+// line along the arm. Length and color (green to red) grow with the queue, reaching the end of
+// the arm at LOD_QUEUE_FULL vehicles; the length is interpolated between prev and cur.
+static size_t addQueueBars(const JunctionView* prev, const JunctionView* cur, float alpha, float x, float y, size_t n){
+    if(!growVehicleBatch(&vehicleBatch,n+NUM_ROADS*NUM_LANES)) return n;
+    float zoom = camera.zoom, inset = LANE_WIDTH/8.0f;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++){
+            float queued = prev->queued[r][l] + ((float)cur->queued[r][l]-prev->queued[r][l])*alpha;
+            if(queued<=0) continue;
+            float t = queued<LOD_QUEUE_FULL ? queued/LOD_QUEUE_FULL : 1;
+            float length = ARM_LENGTH*t;
+            if(length*zoom<1) length = 1/zoom;   // a queue of one is still a pixel
+            float a0 = l*LANE_WIDTH + inset, a1 = (l+1)*LANE_WIDTH - inset;
+            float x0 = x + (arms[r].x + arms[r].cx*a0)*zoom;
+            float y0 = y + (arms[r].y + arms[r].cy*a0)*zoom;
+            float x1 = x + (arms[r].x + arms[r].ax*length + arms[r].cx*a1)*zoom;
+            float y1 = y + (arms[r].y + arms[r].ay*length + arms[r].cy*a1)*zoom;
+            SDL_Color color = {(Uint8)(t<0.5f ? 510*t : 255),(Uint8)(t>0.5f ? 510*(1-t) : 255),40,255};
+            setQuad(n++,x0,y0,x1,y1,color);
+        }
+    return n;
+}
+
+// Lights of one junction as of virtual time shownMs, which lies between the two snapshots.
+// Each road's light is split across the road into one strip per lane, in lane order.
+static size_t addLights(const JunctionView* prev, const JunctionView* cur, Uint64 shownMs, float x, float y, size_t n){
+    if(!growVehicleBatch(&vehicleBatch,n+NUM_MOVEMENTS)) return n;
+    static const SDL_Color red = {255,0,0,255}, green = {0,255,0,255};
+    Uint16 on = shownMs>=cur->phaseStartMs ? cur->green : prev->green;
+    float zoom = camera.zoom, strip = 50.0f/NUM_LANES;
+    for(int i=0;i<NUM_ROADS;i++){
+        float cx = (float)arms[i].cx, cy = (float)arms[i].cy;
+        for(int l=0;l<NUM_LANES;l++){
+            float x0 = x + (lights[i].x + cx*strip*l)*zoom, y0 = y + (lights[i].y + cy*strip*l)*zoom;
+            float x1 = x0 + (cx ? strip : 50)*zoom, y1 = y0 + (cy ? strip : 50)*zoom;
+            setQuad(n++,x0,y0,x1,y1,on&MOVEMENT(i,l) ? green : red);
+        }
+    }
+    return n;
+}
+
+// Draw the queues and lights of every on-screen junction in one SDL_RenderGeometry call.
+// alpha and shownMs place the frame between prev and cur (see drawFrame()). Returns true if
+// a visible junction is still moving between the two.
+bool drawJunctions(const ViewSnapshot* prev, const ViewSnapshot* cur, float alpha, Uint64 shownMs){
+    int c0, c1, r0, r1;
+    if(!visibleJunctions(cur,&c0,&c1,&r0,&r1)) return false;
+    bool lod = camera.zoom<LOD_ZOOM, animating = false;
+    size_t n = 0;
+    for(int row=r0;row<=r1;row++)
+        for(int col=c0;col<=c1;col++){
+            int j = row*cur->cols + col;
+            if(j>=cur->count) break;
+            const JunctionView* c = &cur->junction[j];
+            const JunctionView* p = j<prev->count && prev->cols==cur->cols ? &prev->junction[j] : c;
+            float x, y;
+            junctionOrigin(col,row,&x,&y);
+            if(lod) n = addQueueBars(p,c,alpha,x,y,n);
+            else n = addVehicles(p,c,alpha,x,y,n);
+            n = addLights(p,c,shownMs,x,y,n);
+            if(alpha<1 && (p->green!=c->green || memcmp(p->departed,c->departed,sizeof(c->departed))!=0 ||
+                           (lod && memcmp(p->queued,c->queued,sizeof(c->queued))!=0)))
+                animating = true;
+        }
+    if(n) SDL_RenderGeometry(renderer,NULL,vehicleBatch.vertices,(int)(n*4),vehicleBatch.indices,(int)(n*6));
+    return animating;
+}
+
+void drawText(const char* text, int x, int y){
+    if(!font) return;
+    SDL_Color color = {0,0,0,255};
+    tcDraw(&textCache,text,x,y,color);
+}
+
+// Identify the file behind vehicleFile so a rotated file is noticed even if it grew past our offset
+static bool statVehicleFile(unsigned long long* id, off_t64* size){
+#ifdef _WIN32
+    struct _stat64 st;
+    if(_stat64(vehicleFile,&st)!=0) return false;
+    *id = (unsigned long long)st.st_ctime;
+#else
+    struct stat st;
+    if(stat(vehicleFile,&st)!=0) return false;
+    *id = ((unsigned long long)st.st_dev<<32) ^ (unsigned long long)st.st_ino;
+#endif
+    *size = (off_t64)st.st_size;
+    return true;
+}
+
+// Make everything queued by handoffVehicle() visible to the controller and wake it
+static void publishIngest(){
+    if(ringPublish(&ingestRing)) SDL_SemPost(ingestDoorbell);
+}
+
+// Pass one vehicle to the controller, waiting while the ring is full.
+// Records for unknown roads or lanes are dropped here rather than taking a slot.
+static void handoffVehicle(const Vehicle* v){
+    if(v->road!=RING_RESET_ROAD){
+        int road = v->road-'A', lane = v->lane-1;
+        if(road<0 || road>=NUM_ROADS || lane<0 || lane>=NUM_LANES) return;
+    }
+    RingSlot* slot;
+    while(!(slot=ringReserve(&ingestRing))){
+        publishIngest();
+        perf.ringFullStalls++;
+        SDL_Delay(1);
+    }
+    slot->v = *v;
+}
+
+// Tell the controller to drop everything ingested so far; used when the file is truncated or replaced
+static void resetVehicles(){
+    Vehicle marker = {{0},RING_RESET_ROAD,0,virtualNowMs(),0};
+    handoffVehicle(&marker);
+    publishIngest();
+}
+
+// Parse the complete lines in [data,data+len), hand them to the controller and return how many
+// bytes were consumed. A trailing line without '\n' is left for the next call.
+static size_t ingestLines(FollowState* fs, const char* data, size_t len){
+    VehicleScanner sc;
+    vsInit(&sc,data,len);
+    Vehicle v;
+    v.arrivedMs = virtualNowMs();
+    v.departedMs = 0;
+    int r;
+    while((r=vsNext(&sc,&v.road,&v.lane,v.id))>=0){
+        if(!r) continue;
+        if(headless) v.arrivedMs = fs->records*TEXT_ARRIVAL_MS;
+        fs->records++;
+        handoffVehicle(&v);
+    }
+    return vsConsumed(&sc,data);
+}
+
+// Binary counterpart of ingestLines(): decode whole records, leave a partial one for the next call
+static size_t ingestRecords(const char* data, size_t len){
+    size_t whole = len - len%VLOG_RECORD_SIZE;
+    for(size_t pos=0; pos<whole; pos+=VLOG_RECORD_SIZE){
+        VlogRecord r;
+        if(!vlogDecodeRecord((const unsigned char*)data+pos,&r)) continue;
+        Vehicle v;
+        memcpy(v.id,r.plate,sizeof(r.plate));
+        v.road = r.road;
+        v.lane = r.lane;
+        v.arrivedMs = headless ? r.timeMs : virtualNowMs();
+        v.departedMs = 0;
+        handoffVehicle(&v);
+    }
+    return whole;
+}
+
+// At offset 0, decide between text and binary and consume the binary header.
+// Returns false if more bytes are needed (or the log is unreadable) before ingesting.
+static bool detectFormat(FollowState* fs, const MappedFile* m){
+    size_t probe = m->len<4 ? m->len : 4;
+    if(memcmp(m->data,VLOG_MAGIC,probe)!=0){ fs->binary=false; return true; }
+    if(m->len<VLOG_HEADER_SIZE) return false;
+    VlogHeader h;
+    if(!vlogDecodeHeader((const unsigned char*)m->data,m->len,&h)){
+        SDL_Log("%s: unsupported binary log version", vehicleFile);
+        fs->unsupported = true;
+        fs->offset = (off_t64)m->len; // anything shorter is a truncation
+        return false;
+    }
+    fs->binary=true;
+    fs->offset=VLOG_HEADER_SIZE;
+    return true;
+}
+
+// Read whatever was appended since the last call. Handles truncation and rotation
+// by starting over from byte zero of the (new) file.
+static void followVehicles(FollowState* fs){
+    unsigned long long id; off_t64 size;
+    if(!statVehicleFile(&id,&size)) return;
+
+    if(fs->open && (id!=fs->fileId || size<fs->offset)){
+        resetVehicles();
+        fs->offset=0;
+        fs->unsupported=false;
+    }
+    fs->open=true;
+    fs->fileId=id;
+    if(size==fs->offset || fs->unsupported) return;
+
+    MappedFile m;
+    if(!mapFile(&m,vehicleFile,(unsigned long long)fs->offset,(size_t)(size-fs->offset))) return;
+    size_t skip=0;
+    if(fs->offset==0){
+        if(!detectFormat(fs,&m)){ unmapFile(&m); return; }
+        skip=(size_t)fs->offset;
+    }
+    if(fs->binary) fs->offset += (off_t64)ingestRecords(m.data+skip,m.len-skip);
+    else fs->offset += (off_t64)ingestLines(fs,m.data,m.len);
+    unmapFile(&m);
+    publishIngest();
+}
+
+#if defined(__linux__)
+// Block until VEHICLE_FILE is written, created or renamed into place, or the timeout expires
+static int openWatch(){
+    int fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    if(fd<0) return -1;
+    if(inotify_add_watch(fd,".",IN_MODIFY|IN_CLOSE_WRITE|IN_CREATE|IN_MOVED_TO|IN_DELETE)<0){ close(fd); return -1; }
+    return fd;
+}
+
+static void waitForChange(int fd){
+    if(fd<0){ SDL_Delay(FOLLOW_TIMEOUT_MS); return; }
+    struct pollfd p = {fd,POLLIN,0};
+    if(poll(&p,1,FOLLOW_TIMEOUT_MS)>0){
+        char events[4096];
+        while(read(fd,events,sizeof(events))>0){} // drain; we re-stat the file anyway
+    }
+}
+
+static void closeWatch(int fd){ if(fd>=0) close(fd); }
+#elif defined(_WIN32)
+static HANDLE openWatch(){
+    return FindFirstChangeNotificationA(".",FALSE,FILE_NOTIFY_CHANGE_SIZE|FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME);
+}
+
+static void waitForChange(HANDLE h){
+    if(h==INVALID_HANDLE_VALUE){ SDL_Delay(FOLLOW_TIMEOUT_MS); return; }
+    if(WaitForSingleObject(h,FOLLOW_TIMEOUT_MS)==WAIT_OBJECT_0) FindNextChangeNotification(h);
+}
+
+static void closeWatch(HANDLE h){ if(h!=INVALID_HANDLE_VALUE) FindCloseChangeNotification(h); }
+#else
+static int openWatch(){ return -1; }
+static void waitForChange(int fd){ (void)fd; SDL_Delay(FOLLOW_TIMEOUT_MS); }
+static void closeWatch(int fd){ (void)fd; }
+#endif
+
+int readVehicles(void* arg){
+    FollowState fs = {0,0,false,false,false,0};
+    if(headless){
+        // replay the file as it is now, then let the controller run to completion
+        followVehicles(&fs);
+        SDL_AtomicSet(&ingestDone,1);
+        SDL_SemPost(ingestDoorbell);
+        return 0;
+    }
+#ifdef _WIN32
+    HANDLE watch = openWatch();
+#else
+    int watch = openWatch();
+#endif
+    while(SDL_AtomicGet(&running)){
+        followVehicles(&fs);
+        waitForChange(watch);
+    }
+    closeWatch(watch);
     return 0;
 }
 
-int getPriorityRoad(){
-    SDL_LockMutex(sharedData.mutex);
+static void logLatency(LatencyLog* log, Uint64 ticks){
+    if(log->count==log->capacity){
+        size_t cap = log->capacity ? log->capacity*2 : 1024;
+        Uint64* t = (Uint64*)realloc(log->ticks,cap*sizeof(Uint64));
+        if(!t) return;
+        log->ticks = t;
+        log->capacity = cap;
+    }
+    log->ticks[log->count++] = ticks;
+}
+
+static int compareTicks(const void* a, const void* b){
+    Uint64 x = *(const Uint64*)a, y = *(const Uint64*)b;
+    return x<y ? -1 : x>y;
+}
+
+// Percentiles in microseconds; sorts the log in place
+static void latencyPercentiles(LatencyLog* log, double out[4]){
+    static const double pct[3] = {0.50,0.90,0.99};
+    double us = 1e6/(double)SDL_GetPerformanceFrequency();
+    if(log->count==0){ out[0]=out[1]=out[2]=out[3]=0; return; }
+    qsort(log->ticks,log->count,sizeof(Uint64),compareTicks);
+    for(int i=0;i<3;i++) out[i] = log->ticks[(size_t)(pct[i]*(log->count-1))]*us;
+    out[3] = log->ticks[log->count-1]*us;
+}
+
+// Append a vehicle to its lane queue (the reader already validated road and lane).
+// Only the thread running s calls this: the lanes belong to it.
+static void enqueueVehicle(Simulation* s, const Vehicle* v){
+    int road = v->road-'A', lane = v->lane-1;
+    LaneQueue* q = &s->lanes[road][lane];
+    if(!lqPush(q,v)) SDL_Log("Out of memory queueing %s", v->id);
+    if(lqSize(q)>s->stats.maxQueue) s->stats.maxQueue = lqSize(q);
+    reArrive(&s->arrivalRate[road][lane],v->arrivedMs);
+}
+
+// Move the vehicles the reader has published into the lane queues, stopping at the first one
+// that arrives after upToMs. Returns true if it stopped there, false if the ring ran empty.
+static bool drainIngest(Simulation* s, Uint64 upToMs){
+    unsigned first, n = ringAcquire(&ingestRing,&first);
+    if(!n) return false;
+    Uint64 now = SDL_GetPerformanceCounter();
+    bool stopped = false;
+    for(unsigned i=0;i<n;i++){
+        const RingSlot* slot = ringSlot(&ingestRing,first+i);
+        if(slot->v.road!=RING_RESET_ROAD && slot->v.arrivedMs>upToMs){ n=i; stopped=true; break; }
+        if(slot->v.road==RING_RESET_ROAD){
+            for(int r=0;r<NUM_ROADS;r++)
+                for(int l=0;l<NUM_LANES;l++) lqClear(&s->lanes[r][l]);
+            continue;
+        }
+        enqueueVehicle(s,&slot->v);
+        perf.handoffs++;
+        s->stats.arrivals++;
+        Uint64 latency = now-slot->pushedAt;
+        perf.handoffTicks += latency;
+        if(latency>perf.handoffMaxTicks) perf.handoffMaxTicks=latency;
+    }
+    ringRelease(&ingestRing,n);
+    return stopped;
+}
+
+// Trace counterpart of drainIngest(): queue every vehicle of s->trace that has arrived by upToMs
+static void drainTrace(Simulation* s, Uint64 upToMs){
+    while(s->traceNext<s->traceLen && s->trace[s->traceNext].arrivedMs<=upToMs){
+        enqueueVehicle(s,&s->trace[s->traceNext++]);
+        s->stats.arrivals++;
+    }
+}
+
+// ---- Signal plans ----
+//
+// Each lane carries one movement: lane 1 turns right, lane 2 goes straight on, lane 3 turns
+// left. Traffic keeps left, so a left turn hugs the near kerb and only straight-on and right
+// turns cut across the junction. Two movements from different roads conflict if their paths
+// cross, or if they feed the same exit and neither is a left turn (a left turn merges into the
+// exit's near-side lane, clear of the others).
+
+// How many arms clockwise from its own a movement leaves by
+enum { TURN_LEFT = 1, TURN_STRAIGHT = 2, TURN_RIGHT = 3 };
+static const int laneTurn[NUM_LANES] = {TURN_RIGHT,TURN_STRAIGHT,TURN_LEFT};
+
+// Position of each road clockwise from the top: A top, C right, B bottom, D left (see arms[]).
+// The table is its own inverse, so it also gives the road at each position.
+static const int armPosition[NUM_ROADS] = {0,2,1,3};
+
+// Points on the junction's edge, numbered clockwise: each arm has its exit lanes then its
+// entry lanes, as seen by a driver keeping left
+static int entryPoint(int road){ return 2*armPosition[road]+1; }
+static int exitPoint(int road, int lane){ return 2*((armPosition[road]+laneTurn[lane])%NUM_ROADS); }
+
+static bool strictlyBetween(int p, int a, int b){
+    return a<b ? a<p && p<b : b<p && p<a;
+}
+
+static bool movementsConflict(int road1, int lane1, int road2, int lane2){
+    if(road1==road2) return false;   // lanes of one road run side by side
+    int in1 = entryPoint(road1), out1 = exitPoint(road1,lane1);
+    int in2 = entryPoint(road2), out2 = exitPoint(road2,lane2);
+    if(out1==out2) return laneTurn[lane1]!=TURN_LEFT && laneTurn[lane2]!=TURN_LEFT;
+    // two chords of the edge cross exactly when one separates the other's ends
+    return strictlyBetween(in2,in1,out1)!=strictlyBetween(out2,in1,out1);
+}
+
+// Welsh-Powell order: most conflicts first; on a tie straight on before the turns, so the
+// opposing through movements end up sharing a phase
+static bool colorsBefore(const int degree[], int a, int b){
+    if(degree[a]!=degree[b]) return degree[a]>degree[b];
+    bool sa = laneTurn[a%NUM_LANES]==TURN_STRAIGHT, sb = laneTurn[b%NUM_LANES]==TURN_STRAIGHT;
+    if(sa!=sb) return sa;
+    return a<b;
+}
+
+// Derive the phases from the conflict graph by greedy coloring: each movement, in Welsh-Powell
+// order, joins the first phase it conflicts with nothing in. Each phase is then topped up with
+// every other movement compatible with all of it, so a movement that conflicts with nothing
+// (the left turns) runs in every phase. byRoad (--phases road) gives the old plan instead: one
+// road per phase with all its lanes.
+static void buildSignalPlan(SignalPlan* plan, bool byRoad){
+    memset(plan,0,sizeof(*plan));
+    if(byRoad){
+        for(int r=0;r<NUM_ROADS;r++)
+            for(int l=0;l<NUM_LANES;l++) plan->phase[r] |= MOVEMENT(r,l);
+        plan->count = NUM_ROADS;
+        return;
+    }
+    Uint16 conflicts[NUM_MOVEMENTS];
+    int degree[NUM_MOVEMENTS], order[NUM_MOVEMENTS];
+    for(int m=0;m<NUM_MOVEMENTS;m++){
+        conflicts[m] = 0;
+        degree[m] = 0;
+        for(int n=0;n<NUM_MOVEMENTS;n++){
+            if(!movementsConflict(m/NUM_LANES,m%NUM_LANES,n/NUM_LANES,n%NUM_LANES)) continue;
+            conflicts[m] |= 1u<<n;
+            degree[m]++;
+        }
+        int i = m;
+        while(i>0 && colorsBefore(degree,m,order[i-1])){ order[i] = order[i-1]; i--; }
+        order[i] = m;
+    }
+    for(int i=0;i<NUM_MOVEMENTS;i++){
+        int m = order[i], p = 0;
+        while(p<plan->count && (plan->phase[p]&conflicts[m])) p++;
+        if(p==plan->count) plan->count++;
+        plan->phase[p] |= 1u<<m;
+    }
+    int kept = 0;
+    for(int p=0;p<plan->count;p++){
+        Uint16 set = plan->phase[p];
+        for(int m=0;m<NUM_MOVEMENTS;m++)
+            if(!(set&conflicts[m])) set |= 1u<<m;
+        bool duplicate = false;
+        for(int q=0;q<kept;q++) if(plan->phase[q]==set) duplicate = true;
+        if(!duplicate) plan->phase[kept++] = set;
+    }
+    plan->count = kept;
+}
+
+// Movements of a phase as "A2 B2 A3 ...", road by road
+static void formatPhase(Uint16 set, char* out, size_t size){
+    size_t len = 0;
+    out[0] = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++){
+            if(!(set&MOVEMENT(r,l)) || len+4>size) continue;
+            len += (size_t)snprintf(out+len,size-len,"%s%c%d",len ? " " : "",'A'+r,l+1);
+        }
+}
+
+// ---- Signal policies ----
+//
+// Policies decide from a JunctionState only, so they never touch the lanes or the clock and
+// the same code runs in the live simulation, headless and in every --compare thread. They pick
+// a phase of js->plan; with --phases road a phase is a road and every rule below is the
+// road-level one.
+
+static bool movementGreen(Uint16 set, int road, int lane){
+    return (set&MOVEMENT(road,lane))!=0;
+}
+
+// Vehicles waiting on the movements a phase lights
+static size_t phaseQueue(const JunctionState* js, int phase){
+    size_t n = 0;
+    Uint16 set = js->plan->phase[phase];
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(set,r,l)) n += js->queued[r][l];
+    return n;
+}
+
+static void initPolicy(PolicyState* ps){
+    memset(ps,0,sizeof(*ps));
+}
+
+static int nextInRotation(PolicyState* ps, const JunctionState* js){
+    int phase = ps->rotation%js->plan->count;
+    ps->rotation = (phase+1)%js->plan->count;
+    return phase;
+}
+
+static Uint64 fixedDuration(PolicyState* ps, const JunctionState* js, int choice){
+    (void)ps; (void)js; (void)choice;
+    return PHASE_MS;
+}
+
+// The phase lighting (road, lane) that would release the most vehicles
+static int phaseServing(const JunctionState* js, int road, int lane){
+    int best = -1;
+    size_t most = 0;
+    for(int p=0;p<js->plan->count;p++){
+        if(!movementGreen(js->plan->phase[p],road,lane)) continue;
+        size_t n = phaseQueue(js,p);
+        if(best==-1 || n>most){ best = p; most = n; }
+    }
+    return best;
+}
+
+// The road whose priority lane is forecast to be longest, if that is above the high-water mark;
+// else -1. Going by the forecast lets a filling lane take over before it crosses the mark.
+static int getPriorityRoad(const JunctionState* js){
     int road=-1;
-    for(int i=0;i<4;i++){
-        if(sharedData.counts[i]>10){ road=i; break; }
+    double longest = PRIORITY_HIGH_WATER;
+    for(int i=0;i<NUM_ROADS;i++){
+        double n = js->predicted[i][PRIORITY_LANE-1];
+        if(n>longest){ road=i; longest=n; }
     }
-    SDL_UnlockMutex(sharedData.mutex);
     return road;
 }
 
-DWORD WINAPI manageLights(LPVOID arg){
-    int order[4] = {0,1,2,3};
-    int idx=0;
-    while(1){
-        int prio = getPriorityRoad();
-        SDL_LockMutex(sharedData.mutex);
-        if(prio!=-1) sharedData.currentGreen=prio;
-        else{
-            sharedData.currentGreen = order[idx];
-            idx = (idx+1)%4;
+// A phase serving the red movement with vehicles that has waited longest, if that is at least
+// maxWaitMs; else -1
+static int starvingPhase(const JunctionState* js){
+    int road = -1, lane = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++){
+            if(movementGreen(js->green,r,l) || js->queued[r][l]==0 || js->now-js->redSinceMs[r][l]<maxWaitMs) continue;
+            if(road==-1 || js->redSinceMs[r][l]<js->redSinceMs[road][lane]){ road = r; lane = l; }
+        }
+    return road==-1 ? -1 : phaseServing(js,road,lane);
+}
+
+// The phase whose longest-red movement has been red longest, where the rotation resumes after
+// priority mode
+static int longestRedPhase(const JunctionState* js){
+    int best = -1;
+    Uint64 bestSince = 0;
+    for(int p=0;p<js->plan->count;p++){
+        if(p==js->phase) continue;
+        Uint16 set = js->plan->phase[p];
+        bool red = false;
+        Uint64 since = 0;
+        for(int r=0;r<NUM_ROADS;r++)
+            for(int l=0;l<NUM_LANES;l++){
+                if(!movementGreen(set,r,l) || movementGreen(js->green,r,l)) continue;
+                if(!red || js->redSinceMs[r][l]<since) since = js->redSinceMs[r][l];
+                red = true;
+            }
+        if(red && (best==-1 || since<bestSince)){ best = p; bestSince = since; }
+    }
+    return best==-1 ? js->phase : best;
+}
+
+// Round robin is a two-state machine: normally the rotation through the plan's phases continues;
+// a priority lane above the high-water mark switches to holding a phase that serves it green,
+// phase after phase, until that lane drains below the low-water mark, and the rotation then
+// resumes with the phase that has been red longest.
+static void observeRoundRobin(PolicyState* ps, const JunctionState* js){
+    if(ps->priority && js->queued[ps->priorityRoad][PRIORITY_LANE-1]<PRIORITY_LOW_WATER){
+        ps->priority = false;
+        ps->rotation = longestRedPhase(js);
+    }
+    if(!ps->priority){
+        int prio = getPriorityRoad(js);
+        if(prio!=-1){
+            ps->priority = true;
+            ps->priorityRoad = prio;
+            ps->priorityEntries++;
         }
-        SDL_UnlockMutex(sharedData.mutex);
-        Sleep(5000);
     }
-    return 0;
 }
 
-void refreshScreen(){
-    SDL_SetRenderDrawColor(renderer,255,255,255,255);
-    SDL_RenderClear(renderer);
-    drawRoads();
-    drawLights();
-    SDL_RenderPresent(renderer);
+// In either state a movement with vehicles that has been red for maxWaitMs goes first, which
+// bounds how long any lane can be starved
+static int chooseRoundRobin(PolicyState* ps, const JunctionState* js){
+    int starving = starvingPhase(js);
+    if(starving!=-1){
+        ps->maxWaitOverrides++;
+        return starving;
+    }
+    if(ps->priority) return phaseServing(js,ps->priorityRoad,PRIORITY_LANE-1);
+    return nextInRotation(ps,js);
+}
+
+static void reportRoundRobin(const PolicyState* ps){
+    printf("priority: entered %llu times, %llu phases forced by the %.0f s max wait\n",
+           (unsigned long long)ps->priorityEntries, (unsigned long long)ps->maxWaitOverrides, maxWaitMs/1000.0);
+}
+
+// Fixed time: every phase in turn for PHASE_MS each, whatever is queued
+static int chooseFixedTime(PolicyState* ps, const JunctionState* js){
+    return nextInRotation(ps,js);
+}
+
+// Queue-proportional: the next phase in the rotation that has vehicles. If none has, the green
+// rests where it is until something arrives.
+static int chooseProportional(PolicyState* ps, const JunctionState* js){
+    int count = js->plan->count;
+    for(int i=0;i<count;i++){
+        int phase = (ps->rotation+i)%count;
+        if(phaseQueue(js,phase)==0) continue;
+        ps->rotation = (phase+1)%count;
+        return phase;
+    }
+    return PHASE_KEEP;
+}
+
+// Queue-proportional: green long enough to release the phase's queue at the saturation flow,
+// clamped to [minGreenMs, maxGreenMs]. Its lanes discharge side by side, so the longest one
+// sets the time: |V| / flow for that lane.
+static Uint64 proportionalDuration(PolicyState* ps, const JunctionState* js, int choice){
+    (void)ps;
+    Uint16 set = js->plan->phase[choice==PHASE_KEEP ? js->phase : choice];
+    size_t longest = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(set,r,l) && js->queued[r][l]>longest) longest = js->queued[r][l];
+    Uint64 ms = longest*js->headwayMs;
+    if(ms<minGreenMs) ms = minGreenMs;
+    if(ms>maxGreenMs) ms = maxGreenMs;
+    return ms+1;   // a departure due just as the green ends still gets out
+}
+
+// Upstream queue minus downstream occupancy, summed over the movements a phase releases
+static long phasePressure(const JunctionState* js, int phase){
+    long pressure = 0;
+    Uint16 set = js->plan->phase[phase];
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(set,r,l)) pressure += (long)js->queued[r][l] - (long)js->downstream[r][l];
+    return pressure;
+}
+
+// Max pressure: the phase whose green would relieve the most pressure. Ties keep the current
+// phase, so an idle junction does not cycle.
+static int chooseMaxPressure(PolicyState* ps, const JunctionState* js){
+    (void)ps;
+    int best = js->phase;
+    long most = phasePressure(js,best);
+    for(int p=0;p<js->plan->count;p++){
+        long pressure = phasePressure(js,p);
+        if(pressure>most){ best = p; most = pressure; }
+    }
+    return best==js->phase ? PHASE_KEEP : best;
+}
+
+// Max pressure: a new green lasts at least minGreenMs; one that was re-chosen is reconsidered
+// every PRESSURE_STEP_MS
+static Uint64 maxPressureDuration(PolicyState* ps, const JunctionState* js, int choice){
+    (void)ps; (void)js;
+    return choice==PHASE_KEEP ? PRESSURE_STEP_MS : minGreenMs;
+}
+
+// Selected by name with --controller; the first is the default
+static const SignalPolicy policies[] = {
+    {"round-robin",initPolicy,observeRoundRobin,chooseRoundRobin,fixedDuration,reportRoundRobin},
+    {"fixed-time",initPolicy,NULL,chooseFixedTime,fixedDuration,NULL},
+    {"queue-proportional",initPolicy,NULL,chooseProportional,proportionalDuration,NULL},
+    {"max-pressure",initPolicy,NULL,chooseMaxPressure,maxPressureDuration,NULL},
+};
+
+#define NUM_POLICIES (int)(sizeof(policies)/sizeof(policies[0]))
+
+// ---- Simulation engine ----
+
+// No vehicle waits on any movement in set
+static bool movementsEmpty(const Simulation* s, Uint16 set){
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(set,r,l) && !lqEmpty(&s->lanes[r][l])) return false;
+    return true;
+}
+
+// Vehicles already occupying the road that (road, lane) discharges into: in --grid, the mean
+// lane queue of the neighbour's arm as of the last tick, which is what a vehicle joining one
+// of its lanes at random finds. Exits of an isolated junction, or off the
+// edge of the grid, lead out of the network and never back up.
+static size_t downstreamQueue(const Simulation* s, int road, int lane){
+    const size_t* queued = s->exitQueue[(armPosition[road]+laneTurn[lane])%NUM_ROADS];
+    return queued ? *queued : 0;
+}
+
+// Queue on (road, lane) expected horizonMs from now if the lights stay as they are: the current
+// queue plus the forecast arrivals, less one departure per headway while the movement is green
+static double forecastQueue(const Simulation* s, int road, int lane, double ratePerSec){
+    double q = lqSize(&s->lanes[road][lane]) + ratePerSec*horizonMs/1000.0;
+    if(movementGreen(s->green,road,lane)) q -= (double)horizonMs/s->headwayMs;
+    return q>0 ? q : 0;
+}
+
+// Everything a policy may base a decision on
+static void observeJunction(const Simulation* s, JunctionState* js){
+    js->now = s->now;
+    js->plan = &s->plan;
+    js->phase = s->phase;
+    js->green = s->green;
+    js->phaseStartMs = s->phaseStartMs;
+    js->headwayMs = s->headwayMs;
+    js->started = s->stats.phases>0;
+    for(int r=0;r<NUM_ROADS;r++){
+        for(int l=0;l<NUM_LANES;l++){
+            js->redSinceMs[r][l] = s->redSinceMs[r][l];
+            js->queued[r][l] = lqSize(&s->lanes[r][l]);
+            js->downstream[r][l] = downstreamQueue(s,r,l);
+            double window, ewma;
+            reRates(&s->arrivalRate[r][l],s->now,&window,&ewma);
+            js->arrivalRate[r][l] = window>ewma ? window : ewma;
+            js->predicted[r][l] = forecastQueue(s,r,l,js->arrivalRate[r][l]);
+        }
+    }
+}
+
+// Start timing idle green if the green movements have just run out of vehicles
+static void checkIdleGreen(Simulation* s){
+    if(s->greenIdle || !movementsEmpty(s,s->green)) return;
+    s->greenIdle = true;
+    s->idleSinceMs = s->now;
+}
+
+static void closeIdleGreen(Simulation* s){
+    if(!s->greenIdle) return;
+    s->stats.idleGreenMs += s->now-s->idleSinceMs;
+    s->greenIdle = false;
+}
+
+// Close the green time of the current phase up to the virtual clock
+static void accountGreen(Simulation* s){
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(s->green,r,l)) s->stats.greenMs[r][l] += s->now-s->phaseStartMs;
+    s->phaseStartMs = s->now;
+    closeIdleGreen(s);
+}
+
+// Start the next departure from (road, lane) if its movement is green, the lane has a queue and
+// no departure is already on its way. Vehicles leave one headway apart: the saturation flow.
+static void scheduleDeparture(Simulation* s, int road, int lane){
+    if(!movementGreen(s->green,road,lane) || s->departureScheduled[road][lane] || lqEmpty(&s->lanes[road][lane])) return;
+    eqPush(&s->events,s->now+s->headwayMs,EV_DEPARTURE,road,lane);
+    s->departureScheduled[road][lane] = true;
+}
+
+static void departVehicle(Simulation* s, int road, int lane){
+    Vehicle v;
+    bool left = lqPop(&s->lanes[road][lane],&v);
+    if(!left) return;
+    s->departed[road][lane]++;
+    v.departedMs = s->now;
+    Uint64 wait = v.departedMs-v.arrivedMs;
+    s->stats.departures++;
+    s->stats.waitSumMs += wait;
+    if(wait>s->stats.waitMaxMs) s->stats.waitMaxMs = wait;
+    if(s->waits.enabled) logLatency(&s->waits,wait);
+    forwardVehicle(s,&v);
+    checkIdleGreen(s);
+}
+
+static size_t totalQueued(const Simulation* s){
+    size_t n = 0;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++) n += lqSize(&s->lanes[r][l]);
+    return n;
+}
+
+// Schedule a departure on every green movement that has none on its way
+static void scheduleGreenDepartures(Simulation* s){
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++) scheduleDeparture(s,r,l);
+}
+
+// Movements that stay green across the change keep running; the others turn red now
+static void startPhase(Simulation* s, int phase){
+    accountGreen(s);
+    Uint16 next = s->plan.phase[phase];
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++)
+            if(movementGreen(s->green,r,l) && !movementGreen(next,r,l)) s->redSinceMs[r][l] = s->now;
+    s->phase = phase;
+    s->green = next;
+    s->stats.phases++;
+    checkIdleGreen(s);
+    scheduleGreenDepartures(s);
+}
+
+// Release everything a simulation allocated
+static void freeSimulation(Simulation* s){
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++) lqFree(&s->lanes[r][l]);
+    eqFree(&s->events);
+    free(s->waits.ticks);
+    s->waits.ticks = NULL;
+}
+
+// --flow: saturation flow per lane in vehicles per second
+static bool parseFlow(const char* arg){
+    double flow = atof(arg);
+    if(flow<=0) return false;
+    sim.headwayMs = (Uint64)(1000/flow);
+    if(sim.headwayMs==0) sim.headwayMs = 1;
+    return true;
+}
+
+// --controller: any name in policies[]
+static bool parseController(const char* arg){
+    for(int i=0;i<NUM_POLICIES;i++)
+        if(strcmp(arg,policies[i].name)==0){ sim.policy = &policies[i]; return true; }
+    return false;
+}
+
+// --phases: movement (the plan derived from the conflict graph) or road (one road at a time)
+static bool parsePhases(const char* arg){
+    if(strcmp(arg,"movement")==0) roadPhases = false;
+    else if(strcmp(arg,"road")==0) roadPhases = true;
+    else return false;
+    return true;
+}
+
+void addObserver(SimObserver fn){
+    if(sim.observerCount<MAX_OBSERVERS) sim.observers[sim.observerCount++] = fn;
+}
+
+// Tell the render loop the picture is out of date; safe from any thread
+void markViewDirty(){
+    if(!SDL_AtomicCAS(&viewDirty,0,1) || wakeEvent==(Uint32)-1) return;
+    SDL_Event wake;
+    SDL_zero(wake);
+    wake.type = wakeEvent;
+    SDL_PushEvent(&wake);
+}
+
+// The part of a snapshot that shows junction s
+static void fillJunctionView(JunctionView* j, const Simulation* s){
+    j->green = s->green;
+    j->phaseStartMs = s->phaseStartMs;
+    for(int r=0;r<NUM_ROADS;r++)
+        for(int l=0;l<NUM_LANES;l++){
+            j->queued[r][l] = (Uint32)lqSize(&s->lanes[r][l]);
+            j->departed[r][l] = s->departed[r][l];
+        }
+}
+
+// Copy the state the renderer needs into the back snapshot and flip it in.
+// Called by the controller, the only thread that touches the lanes, so no lock is taken.
+static void publishView(){
+    ViewSnapshot* view = viewSnapshots[tbBack(&viewBuffer)];
+    view->seq = ++sim.viewSeq;
+    view->simMs = sim.now;
+    view->cols = 1;
+    view->count = 1;
+    fillJunctionView(&view->junction[0],&sim);
+    view->arrivals = sim.stats.arrivals;
+    view->decisionTicks = sim.decisionTicks;
+    tbPublish(&viewBuffer);
+}
+
+// Every event changes what is on screen, the lights or a queue length; the
+// snapshot itself is published once per tick
+static void publishToView(const Event* ev){
+    (void)ev;
+    sim.viewChanged = true;
+}
+
+// End of a windowed-mode tick: hand the state to the renderer if anything changed during it
+static void publishTick(){
+    if(!sim.viewChanged) return;
+    publishView();
+    markViewDirty();
+    sim.viewChanged = false;
+}
+
+// Windowed mode: sleep until the virtual clock reaches untilMs, or the program shuts down.
+// The doorbell may end a wait early; new vehicles are picked up at the next tick.
+static void waitForTick(Uint64 untilMs){
+    while(SDL_AtomicGet(&running)){
+        Uint64 now = virtualNowMs();
+        if(now>=untilMs) return;
+        SDL_SemWaitTimeout(ingestDoorbell,(Uint32)((untilMs-now)/simSpeed)+1);
+    }
+}
+
+// Make sure the vehicle at the head of the ingest stream has an EV_ARRIVAL scheduled. In headless
+// mode this waits for the reader: no later event may run before we know when that vehicle arrives.
+// A simulation replaying an in-memory trace reads the next vehicle from it instead.
+static void scheduleNextArrival(Simulation* s){
+    if(s->arrivalScheduled || s->inputExhausted) return;
+    if(s->trace){
+        if(s->traceNext==s->traceLen){ s->inputExhausted = true; return; }
+        Uint64 t = s->trace[s->traceNext].arrivedMs;
+        eqPush(&s->events,t>s->now ? t : s->now,EV_ARRIVAL,0,0);
+        s->arrivalScheduled = true;
+        return;
+    }
+    unsigned first;
+    while(1){
+        bool done = headless && SDL_AtomicGet(&ingestDone);
+        if(ringAcquire(&ingestRing,&first)){
+            Uint64 t = ringSlot(&ingestRing,first)->v.arrivedMs;
+            eqPush(&s->events,t>s->now ? t : s->now,EV_ARRIVAL,0,0);
+            s->arrivalScheduled = true;
+            return;
+        }
+        if(!headless) return;
+        if(done){ s->inputExhausted = true; return; }
+        SDL_SemWait(ingestDoorbell);
+    }
+}
+
+// Ask the policy for the next phase and how long until it decides again
+static void decidePhase(Simulation* s){
+    const SignalPolicy* p = s->policy;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    JunctionState js;
+    observeJunction(s,&js);
+    if(p->observe) p->observe(&s->policyState,&js);
+    int phase = p->choosePhase(&s->policyState,&js);
+    if(phase==PHASE_KEEP && !js.started) phase = s->phase;   // the first decision always starts a phase
+    Uint64 next = p->chooseDuration(&s->policyState,&js,phase);
+    s->decisionTicks = SDL_GetPerformanceCounter()-t0;
+    if(decisionLog.enabled) logLatency(&decisionLog,s->decisionTicks);
+    if(phase!=PHASE_KEEP) startPhase(s,phase);
+    eqPush(&s->events,s->now+next,EV_PHASE,0,0);
+}
+
+static void handleEvent(Simulation* s, const Event* ev){
+    switch(ev->type){
+        case EV_ARRIVAL:
+            s->arrivalScheduled = false;
+            if(s->trace) drainTrace(s,s->now);
+            else drainIngest(s,s->now);
+            if(!movementsEmpty(s,s->green)) closeIdleGreen(s);
+            scheduleGreenDepartures(s);
+            break;
+        case EV_PHASE:
+            decidePhase(s);
+            break;
+        case EV_FRAME:
+            // the capture itself is done by the --record observer
+            eqPush(&s->events,s->now+s->frameMs,EV_FRAME,0,0);
+            break;
+        case EV_DEPARTURE:
+            // a departure left over from an earlier green phase of this movement is simply dropped
+            s->departureScheduled[ev->road][ev->lane] = false;
+            if(movementGreen(s->green,ev->road,ev->lane)) departVehicle(s,ev->road,ev->lane);
+            scheduleDeparture(s,ev->road,ev->lane);
+            break;
+    }
+    for(int i=0;i<s->observerCount;i++) s->observers[i](ev);
+}
+
+// Pick the policy and signal plan and schedule the first decision
+static void startSimulation(Simulation* s){
+    if(!s->policy) s->policy = &policies[0];
+    if(s->plan.count==0) buildSignalPlan(&s->plan,roadPhases);
+    s->policy->init(&s->policyState);
+    eqPush(&s->events,s->now,EV_PHASE,0,0);
+}
+
+// Run every event due before endMs and leave the clock there: one --grid tick. The input is
+// s->trace, which the caller extends between calls.
+static void advanceSimulation(Simulation* s, Uint64 endMs){
+    while(1){
+        scheduleNextArrival(s);
+        if(eqPeek(&s->events)->time>=endMs) break;   // a decision is always pending
+        Event ev;
+        eqPop(&s->events,&ev);
+        s->now = ev.time;
+        handleEvent(s,&ev);
+    }
+    s->now = endMs;
+}
+
+// Event loop. Windowed mode paces the virtual clock against SDL_GetTicks64() and runs until
+// shutdown; headless mode jumps straight from event to event until every vehicle in the
+// input has arrived and left.
+// Headless, events run back to back. Windowed, the clock advances in fixed ticks of
+// tickStepMs(): every event up to the end of a tick runs, the result is published
+// as one snapshot, and the controller sleeps until the wall clock reaches the next tick.
+static void runSimulation(Simulation* s){
+    startSimulation(s);
+    Uint64 tickEnd = s->now;
+    while(SDL_AtomicGet(&running)){
+        scheduleNextArrival(s);
+        if(s->inputExhausted && totalQueued(s)==0) break;
+        if(s->realtime && eqPeek(&s->events)->time>tickEnd){
+            s->now = tickEnd;
+            publishTick();
+            tickEnd += tickStepMs();
+            waitForTick(tickEnd);
+            continue;
+        }
+        Event ev;
+        eqPop(&s->events,&ev);
+        s->now = ev.time;
+        handleEvent(s,&ev);
+    }
+    accountGreen(s);
+}
+
+int manageLights(void* arg){
+    sim.realtime = true;
+    addObserver(publishToView);
+    runSimulation(&sim);
+    return 0;
+}
+
+static void printRunReport(double wallSec){
+    const RunStats* st = &sim.stats;
+    Uint64 simMs = sim.now;
+    Uint64 waiting = 0, ageSum = 0, ageMax = 0;
+    printf("simulated %.1f s in %.3f s wall (%.0fx real time)\n", simMs/1000.0, wallSec, simMs/1000.0/wallSec);
+    printf("vehicles: %llu arrived, %.0f vehicles/s ingest throughput, %llu phases\n",
+           (unsigned long long)st->arrivals, st->arrivals/wallSec, (unsigned long long)st->phases);
+    printf("departed: %llu vehicles, %.3f vehicles/s junction throughput, mean wait %.1f s, max wait %.1f s\n",
+           (unsigned long long)st->departures, simMs ? st->departures*1000.0/simMs : 0.0,
+           st->departures ? st->waitSumMs/1000.0/st->departures : 0.0, st->waitMaxMs/1000.0);
+    printf("idle green: %.1f s, %.1f%% of the time no green movement had a vehicle to release\n",
+           st->idleGreenMs/1000.0, simMs ? 100.0*st->idleGreenMs/simMs : 0.0);
+    printf("signal plan: %d phases:", sim.plan.count);
+    for(int p=0;p<sim.plan.count;p++){
+        char movements[4*NUM_MOVEMENTS];
+        formatPhase(sim.plan.phase[p],movements,sizeof(movements));
+        printf(" [%s]", movements);
+    }
+    printf("\n");
+    if(sim.policy->report) sim.policy->report(&sim.policyState);
+    printf("road  green%%   lane1   lane2   lane3\n");
+    for(int r=0;r<NUM_ROADS;r++){
+        Uint64 greenMs = 0;   // the mean over the road's lanes
+        for(int l=0;l<NUM_LANES;l++) greenMs += st->greenMs[r][l];
+        printf("%c     %5.1f", 'A'+r, simMs ? 100.0*greenMs/NUM_LANES/simMs : 0.0);
+        for(int l=0;l<NUM_LANES;l++){
+            const LaneQueue* q = &sim.lanes[r][l];
+            printf(" %7zu", lqSize(q));
+            for(size_t i=0;i<lqSize(q);i++){
+                Uint64 age = simMs - lqAt(q,i)->arrivedMs;
+                ageSum += age;
+                if(age>ageMax) ageMax = age;
+            }
+            waiting += lqSize(q);
+        }
+        printf("\n");
+    }
+    printf("waiting at end: %llu vehicles, mean wait %.1f s, max wait %.1f s\n",
+           (unsigned long long)waiting, waiting ? ageSum/1000.0/waiting : 0.0, ageMax/1000.0);
+}
+
+// Run the same controller on a virtual clock as fast as possible, then report
+void runHeadless(){
+    Uint64 wallStart = SDL_GetPerformanceCounter();
+    sim.realtime = false;
+    runSimulation(&sim);
+    double wallSec = (SDL_GetPerformanceCounter()-wallStart)/(double)SDL_GetPerformanceFrequency();
+    printRunReport(wallSec>0 ? wallSec : 1e-9);
+}
+
+void printPerfCounters(){
+    double us = 1e6/(double)SDL_GetPerformanceFrequency();
+    SDL_Log("ingest handoff: %llu vehicles, mean latency %.1f us (max %.1f us), %llu ring-full stalls",
+            (unsigned long long)perf.handoffs,
+            perf.handoffs ? perf.handoffTicks*us/perf.handoffs : 0.0, perf.handoffMaxTicks*us,
+            (unsigned long long)perf.ringFullStalls);
+    if(frameStats.frames){
+        LatencyLog recent = {0};
+        Uint64 n = frameStats.frames<FRAME_HISTORY ? frameStats.frames : FRAME_HISTORY;
+        for(Uint64 i=0;i<n;i++) logLatency(&recent,frameStats.ticks[i]);
+        double pct[4];
+        latencyPercentiles(&recent,pct);
+        free(recent.ticks);
+        SDL_Log("frames: %llu presented in %llu wakeups, mean %.2f ms; last %llu: p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+                (unsigned long long)frameStats.frames,(unsigned long long)frameStats.wakeups,
+                frameStats.totalTicks*us/1000/frameStats.frames,(unsigned long long)n,pct[0]/1000,pct[2]/1000,pct[3]/1000);
+    }
+}
+
+// Software renderer drawing into a plain surface, for --bench and --record: no display needed.
+// Returns the target surface, or NULL (with renderer NULL) if it could not be created.
+static SDL_Surface* openOffscreen(){
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0,WINDOW_WIDTH,WINDOW_HEIGHT,32,SDL_PIXELFORMAT_ARGB8888);
+    renderer = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+    if(TTF_Init()==0) font = TTF_OpenFont(MAIN_FONT,24);
+    tcInit(&textCache,renderer,font);
+    return target;
+}
+
+static void closeOffscreen(SDL_Surface* target){
+    tcFree(&textCache);
+    freeVehicleBatch();
+    invalidateBackground(true);
+    if(font) TTF_CloseFont(font);
+    if(renderer) SDL_DestroyRenderer(renderer);
+    if(target) SDL_FreeSurface(target);
+    font = NULL;
+    renderer = NULL;
+    TTF_Quit();
+}
+
+// ---- Benchmarks (--bench) ----
+//
+// Each workload is a seeded, generated vehicle file replayed headless through the reader and the
+// controller, followed by a burst of frames rendered offscreen with the software renderer.
+// Uniform workloads are text files (one vehicle per second, the generator's format), so they
+// exercise the text parse path; bursty ones need timestamps and are binary logs.
+
+#define BENCH_FRAMES 300
+
+typedef struct {
+    const char* name;
+    Uint64 vehicles;
+} BenchSize;
+
+static const BenchSize benchSizes[] = {{"small",10000},{"1m",1000000},{"100m",100000000}};
+
+// xorshift64*: small, fast and identical on every platform, unlike rand()
+static Uint64 benchRandom(Uint64* state){
+    *state ^= *state>>12;
+    *state ^= *state<<25;
+    *state ^= *state>>27;
+    return *state * 2685821657736338717ULL;
+}
+
+static void benchPlate(Uint64* rng, char* plate){
+    static const char pattern[] = "AA0AA000";
+    for(int i=0;i<8;i++){
+        Uint64 r = benchRandom(rng)>>33;
+        plate[i] = pattern[i]=='A' ? (char)('A'+r%26) : (char)('0'+r%10);
+    }
+    plate[8] = 0;
+}
+
+static bool benchFileReady(const char* path, long long expectBytes){
+    FILE* f = fopen(path,"rb");
+    if(!f) return false;
+    fseeko(f,0,SEEK_END);
+    long long size = (long long)ftello(f);
+    fclose(f);
+    return size==expectBytes;
+}
+
+// Write the workload once; later runs reuse it. Bursty arrivals alternate 10 s at 200 vehicles/s
+// with 50 s at 8 vehicles/s (40/s on average), which keeps 100 M vehicles inside the binary
+// log's 49-day time range.
+static bool generateWorkload(const char* path, Uint64 vehicles, bool bursty){
+    long long expect = bursty ? VLOG_HEADER_SIZE+(long long)vehicles*VLOG_RECORD_SIZE : (long long)vehicles*VP_RECORD_LEN;
+    if(benchFileReady(path,expect)) return true;
+    FILE* f = fopen(path,"wb");
+    if(!f){ perror(path); return false; }
+    setvbuf(f,NULL,_IOFBF,1<<20);
+    Uint64 rng = 0x9E3779B97F4A7C15ULL ^ vehicles ^ (bursty ? 1 : 0);
+    if(bursty) vlogWriteHeader(f,0);
+    Uint64 t = 0;
+    for(Uint64 i=0;i<vehicles;i++){
+        char plate[9];
+        benchPlate(&rng,plate);
+        char road = (char)('A'+(benchRandom(&rng)>>33)%NUM_ROADS);
+        int lane = (int)((benchRandom(&rng)>>33)%NUM_LANES)+1;
+        if(bursty){
+            bool burst = (t/1000)%60 < 10;
+            t += burst ? 5 : 125;
+            vlogWriteRecord(f,road,lane,plate,(uint32_t)t);
+        }
+        else fprintf(f,"%c %d %s\n",road,lane,plate);
+    }
+    return fclose(f)==0;
+}
+
+// Put every global back to its start-up state between workloads
+static void resetSimulation(){
+    Uint64 headway = sim.headwayMs;
+    const SignalPolicy* policy = sim.policy;
+    freeSimulation(&sim);
+    memset(&sim,0,sizeof(sim));
+    sim.headwayMs = headway;
+    sim.policy = policy;
+    memset(&perf,0,sizeof(perf));
+    SDL_AtomicSet(&ingestRing.head,0);
+    SDL_AtomicSet(&ingestRing.tail,0);
+    ingestRing.pending = 0;
+    SDL_AtomicSet(&ingestDone,0);
+    decisionLog.count = 0;
+}
+
+static long peakRssKb(){
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if(!K32GetProcessMemoryInfo(GetCurrentProcess(),&pmc,sizeof(pmc))) return -1;
+    return (long)(pmc.PeakWorkingSetSize/1024);
+#else
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF,&ru)!=0) return -1;
+#ifdef __APPLE__
+    return ru.ru_maxrss/1024;
+#else
+    return ru.ru_maxrss;
+#endif
+#endif
+}
+
+typedef struct {
+    char name[32];
+    Uint64 vehicles;
+    const char* format;
+    const char* controller;
+    double wallSec, simSec, ingestVps;
+    double throughputVps;   // departures per simulated second
+    double meanDelaySec;    // arrival to departure; every vehicle has left when a workload ends
+    double idleGreenPct;    // share of the run with no vehicle on a green movement
+    double decisionUs[4];   // p50, p90, p99, max
+    double frameMs[4];
+    long peakRssKb;
+} BenchResult;
+
+static void printBenchResult(const BenchResult* r, bool csv, bool first){
+    if(csv){
+        if(first) printf("workload,vehicles,format,controller,wall_s,sim_s,ingest_vps,throughput_vps,mean_delay_s,idle_green_pct,"
+                         "decision_p50_us,decision_p90_us,decision_p99_us,decision_max_us,"
+                         "frame_p50_ms,frame_p90_ms,frame_p99_ms,frame_max_ms,peak_rss_kb\n");
+        printf("%s,%llu,%s,%s,%.4f,%.1f,%.0f,%.4f,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%ld\n",
+               r->name,(unsigned long long)r->vehicles,r->format,r->controller,r->wallSec,r->simSec,r->ingestVps,
+               r->throughputVps,r->meanDelaySec,r->idleGreenPct,
+               r->decisionUs[0],r->decisionUs[1],r->decisionUs[2],r->decisionUs[3],
+               r->frameMs[0],r->frameMs[1],r->frameMs[2],r->frameMs[3],r->peakRssKb);
+        return;
+    }
+    printf("%s\n    {\"workload\": \"%s\", \"vehicles\": %llu, \"format\": \"%s\", \"controller\": \"%s\",\n"
+           "     \"wall_s\": %.4f, \"sim_s\": %.1f, \"ingest_vps\": %.0f,\n"
+           "     \"throughput_vps\": %.4f, \"mean_delay_s\": %.2f, \"idle_green_pct\": %.2f,\n"
+           "     \"decision_us\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n"
+           "     \"frame_ms\": {\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}, \"peak_rss_kb\": %ld}",
+           first ? "" : ",", r->name,(unsigned long long)r->vehicles,r->format,r->controller,
+           r->wallSec,r->simSec,r->ingestVps,r->throughputVps,r->meanDelaySec,r->idleGreenPct,
+           r->decisionUs[0],r->decisionUs[1],r->decisionUs[2],r->decisionUs[3],
+           r->frameMs[0],r->frameMs[1],r->frameMs[2],r->frameMs[3],r->peakRssKb);
+}
+
+static void workloadPath(char* path, size_t n, const BenchSize* size, bool bursty){
+    snprintf(path,n,"bench_%s_%s.%s",size->name,bursty ? "bursty" : "uniform",bursty ? "vlog" : "data");
+}
+
+// Bench observer: publish a snapshot each time the longest lane queue reaches a new peak, so the
+// frames are timed against the busiest picture of the run. Costs a compare per event.
+static size_t benchPeakQueue;
+static void publishPeak(const Event* ev){
+    (void)ev;
+    if(sim.stats.maxQueue<=benchPeakQueue) return;
+    benchPeakQueue = sim.stats.maxQueue;
+    publishView();
+}
+
+static void runWorkload(const BenchSize* size, bool bursty, BenchResult* out){
+    char path[64];
+    workloadPath(path,sizeof(path),size,bursty);
+    memset(out,0,sizeof(*out));
+    snprintf(out->name,sizeof(out->name),"%s-%s",size->name,bursty ? "bursty" : "uniform");
+    out->vehicles = size->vehicles;
+    out->format = bursty ? "binary" : "text";
+    out->controller = sim.policy->name;
+    if(!generateWorkload(path,size->vehicles,bursty)) return;
+
+    resetSimulation();
+    resetView();
+    benchPeakQueue = 0;
+    addObserver(publishPeak);
+    vehicleFile = path;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    SDL_Thread* reader = SDL_CreateThread(readVehicles,"readVehicles",NULL);
+    runSimulation(&sim);
+    SDL_WaitThread(reader,NULL);
+    const RunStats* st = &sim.stats;
+    out->wallSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+    out->simSec = sim.now/1000.0;
+    out->ingestVps = st->arrivals/(out->wallSec>0 ? out->wallSec : 1e-9);
+    out->throughputVps = sim.now ? st->departures*1000.0/sim.now : 0;
+    out->meanDelaySec = st->departures ? st->waitSumMs/1000.0/st->departures : 0;
+    out->idleGreenPct = sim.now ? 100.0*st->idleGreenMs/sim.now : 0;
+    latencyPercentiles(&decisionLog,out->decisionUs);
+
+    // render the junction offscreen as it was at its longest queue; by the end it has drained
+    if(!sim.viewSeq) publishView();
+    LatencyLog frames = {0};
+    for(int i=0;i<BENCH_FRAMES && renderer;i++){
+        Uint64 f0 = SDL_GetPerformanceCounter();
+        refreshScreen();
+        logLatency(&frames,SDL_GetPerformanceCounter()-f0);
+    }
+    latencyPercentiles(&frames,out->frameMs);
+    for(int i=0;i<4;i++) out->frameMs[i] /= 1000.0;
+    free(frames.ticks);
+    out->peakRssKb = peakRssKb();
+}
+
+// sim --bench [small|1m|100m|all ...] [--format json|csv] [--controller ...] [--phases ...] [--min-green ms]
+//             [--max-green ms]
+// Default workloads are small and 1m; 100m needs about 3 GB of disk and several GB of memory.
+int runBenchmarks(int argc, char* argv[]){
+    bool csv = false, pick[3] = {false,false,false}, any = false;
+    for(int i=0;i<argc;i++){
+        if(strcmp(argv[i],"--format")==0 && i+1<argc){ csv = strcmp(argv[++i],"csv")==0; continue; }
+        if(strcmp(argv[i],"--controller")==0 && i+1<argc && parseController(argv[i+1])){ i++; continue; }
+        if(strcmp(argv[i],"--phases")==0 && i+1<argc && parsePhases(argv[i+1])){ i++; continue; }
+        if(strcmp(argv[i],"--min-green")==0 && i+1<argc && atoi(argv[i+1])>0){ minGreenMs = (Uint64)atoi(argv[++i]); continue; }
+        if(strcmp(argv[i],"--max-green")==0 && i+1<argc && atoi(argv[i+1])>0){ maxGreenMs = (Uint64)atoi(argv[++i]); continue; }
+        bool known = false;
+        for(int s=0;s<3;s++){
+            if(strcmp(argv[i],benchSizes[s].name)==0 || strcmp(argv[i],"all")==0){ pick[s] = true; known = true; }
+        }
+        if(!known){ fprintf(stderr,"unknown workload '%s' (small, 1m, 100m, all)\n",argv[i]); return 2; }
+        any = true;
+    }
+    if(!any) pick[0] = pick[1] = true;
+
+    headless = true;
+    sim.headwayMs = (Uint64)(1000/DEFAULT_FLOW);
+    if(!sim.policy) sim.policy = &policies[0];
+    if(!ringInit(&ingestRing)){ SDL_Log("Out of memory for the ingest ring"); return 1; }
+    ingestDoorbell = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&running,1);
+    if(!allocView(1)){ SDL_Log("Out of memory for the view"); return 1; }
+    resetView();
+    decisionLog.enabled = true;
+
+    // offscreen software target so refreshScreen() can be timed without a display
+    SDL_Surface* target = openOffscreen();
+    if(!renderer) SDL_Log("Software renderer unavailable, skipping frame timings: %s",SDL_GetError());
+
+    if(!csv) printf("{\"benchmarks\": [");
+    bool first = true;
+    for(int s=0;s<3;s++){
+        if(!pick[s]) continue;
+        for(int bursty=0;bursty<2;bursty++){
+            BenchResult r;
+            runWorkload(&benchSizes[s],bursty!=0,&r);
+            printBenchResult(&r,csv,first);
+            first = false;
+            fflush(stdout);
+        }
+    }
+    if(!csv) printf("\n]}\n");
+
+    closeOffscreen(target);
+    free(decisionLog.ticks);
+    ringFree(&ingestRing);
+    SDL_DestroySemaphore(ingestDoorbell);
+    freeSimulation(&sim);
+    freeView();
+    return 0;
+}
+
+// ---- Policy comparison (--compare) ----
+//
+// One seeded workload (or any vehicle file) is read into memory once and replayed through every
+// policy in policies[] at the same time, one thread and one Simulation each. The runs share
+// only the read-only trace and the policy parameters, so their results do not depend on how
+// the threads are scheduled and match a headless run of the same file.
+
+typedef struct {
+    const SignalPolicy* policy;
+    const Vehicle* trace;
+    size_t traceLen;
+    Uint64 headwayMs;
+    bool ok;
+    double wallSec;
+    double throughputVps;
+    double meanDelaySec;
+    double p95DelaySec, p99DelaySec;
+    size_t maxQueue;
+} PolicyRun;
+
+static bool validVehicle(const Vehicle* v){
+    return v->road>='A' && v->road<'A'+NUM_ROADS && v->lane>=1 && v->lane<=NUM_LANES;
+}
+
+// Read a whole vehicle file, timed as a headless replay would time it: binary logs carry their
+// own timestamps, text lines arrive TEXT_ARRIVAL_MS apart. Returns the number of vehicles in
+// *out (malloc'ed, caller frees), or 0 if there are none or the file cannot be read.
+static size_t loadTrace(const char* path, Vehicle** out){
+    *out = NULL;
+    FILE* f = fopen(path,"rb");
+    if(!f){ perror(path); return 0; }
+    fseeko(f,0,SEEK_END);
+    long long size = (long long)ftello(f);
+    fclose(f);
+    MappedFile m;
+    if(size<=0 || !mapFile(&m,path,0,(size_t)size)) return 0;
+    size_t count = 0, capacity = 0;
+    Vehicle* trace = NULL;
+    Vehicle v;
+    v.departedMs = 0;
+    if(vlogIsLog(m.data,m.len)){
+        VlogHeader h;
+        size_t records = m.len<VLOG_HEADER_SIZE ? 0 : (m.len-VLOG_HEADER_SIZE)/VLOG_RECORD_SIZE;
+        if(vlogDecodeHeader((const unsigned char*)m.data,m.len,&h)) capacity = records;
+        else SDL_Log("%s: unsupported binary log version", path);
+        trace = capacity ? (Vehicle*)malloc(capacity*sizeof(Vehicle)) : NULL;
+        for(size_t i=0;i<records && trace;i++){
+            VlogRecord r;
+            if(!vlogDecodeRecord((const unsigned char*)m.data+VLOG_HEADER_SIZE+i*VLOG_RECORD_SIZE,&r)) continue;
+            memcpy(v.id,r.plate,sizeof(r.plate));
+            v.road = r.road;
+            v.lane = r.lane;
+            v.arrivedMs = r.timeMs;
+            if(validVehicle(&v)) trace[count++] = v;
+        }
+    }
+    else {
+        // fixed-length lines are the common case; grow if the file has longer ones
+        capacity = m.len/VP_RECORD_LEN+1;
+        trace = (Vehicle*)malloc(capacity*sizeof(Vehicle));
+        VehicleScanner sc;
+        vsInit(&sc,m.data,m.len);
+        int r;
+        Uint64 records = 0;
+        while(trace && (r=vsNext(&sc,&v.road,&v.lane,v.id))>=0){
+            if(!r) continue;
+            v.arrivedMs = records++*TEXT_ARRIVAL_MS;
+            if(!validVehicle(&v)) continue;
+            if(count==capacity){
+                Vehicle* t = (Vehicle*)realloc(trace,capacity*2*sizeof(Vehicle));
+                if(!t){ free(trace); trace = NULL; count = 0; break; }
+                trace = t;
+                capacity *= 2;
+            }
+            trace[count++] = v;
+        }
+    }
+    unmapFile(&m);
+    if(!trace && capacity) SDL_Log("Out of memory loading %s", path);
+    if(!count){ free(trace); return 0; }
+    *out = trace;
+    return count;
+}
+
+// Delay percentile in seconds from a sorted log of per-vehicle waits in ms
+static double waitPercentileSec(const LatencyLog* waits, double p){
+    return waits->count ? waits->ticks[(size_t)(p*(waits->count-1))]/1000.0 : 0;
+}
+
+static int runPolicy(void* arg){
+    PolicyRun* run = (PolicyRun*)arg;
+    Simulation* s = (Simulation*)calloc(1,sizeof(Simulation));
+    if(!s) return 1;
+    s->policy = run->policy;
+    s->headwayMs = run->headwayMs;
+    s->trace = run->trace;
+    s->traceLen = run->traceLen;
+    s->waits.enabled = true;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    runSimulation(s);
+    run->wallSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+    const RunStats* st = &s->stats;
+    run->throughputVps = s->now ? st->departures*1000.0/s->now : 0;
+    run->meanDelaySec = st->departures ? st->waitSumMs/1000.0/st->departures : 0;
+    qsort(s->waits.ticks,s->waits.count,sizeof(Uint64),compareTicks);
+    run->p95DelaySec = waitPercentileSec(&s->waits,0.95);
+    run->p99DelaySec = waitPercentileSec(&s->waits,0.99);
+    run->maxQueue = st->maxQueue;
+    run->ok = s->waits.count==st->departures;   // false if the delay log ran out of memory
+    freeSimulation(s);
+    free(s);
+    return 0;
+}
+
+// sim --compare [small|1m|100m][-uniform|-bursty] | file [--flow ...] [--phases ...] [--min-green ms] [--max-green ms]
+//               [--max-wait ms] [--horizon ms]
+// The workload defaults to 1m-uniform and is generated like the --bench one of the same name.
+int runComparison(int argc, char* argv[]){
+    const char* source = "1m-uniform";
+    sim.headwayMs = (Uint64)(1000/DEFAULT_FLOW);
+    for(int i=0;i<argc;i++){
+        if(strcmp(argv[i],"--flow")==0 && i+1<argc && parseFlow(argv[i+1])){ i++; continue; }
+        if(strcmp(argv[i],"--phases")==0 && i+1<argc && parsePhases(argv[i+1])){ i++; continue; }
+        if(strcmp(argv[i],"--min-green")==0 && i+1<argc && atoi(argv[i+1])>0){ minGreenMs = (Uint64)atoi(argv[++i]); continue; }
+        if(strcmp(argv[i],"--max-green")==0 && i+1<argc && atoi(argv[i+1])>0){ maxGreenMs = (Uint64)atoi(argv[++i]); continue; }
+        if(strcmp(argv[i],"--max-wait")==0 && i+1<argc && atoi(argv[i+1])>0){ maxWaitMs = (Uint64)atoi(argv[++i]); continue; }
+        if(strcmp(argv[i],"--horizon")==0 && i+1<argc && atoi(argv[i+1])>=0){ horizonMs = (Uint64)atoi(argv[++i]); continue; }
+        if(argv[i][0]=='-'){ fprintf(stderr,"unknown option '%s'\n",argv[i]); return 2; }
+        source = argv[i];
+    }
+
+    char path[64];
+    const char* file = source;
+    for(int s=0;s<3;s++){
+        size_t n = strlen(benchSizes[s].name);
+        if(strncmp(source,benchSizes[s].name,n)!=0 || source[n]!='-') continue;
+        bool bursty = strcmp(source+n+1,"bursty")==0;
+        if(!bursty && strcmp(source+n+1,"uniform")!=0) continue;
+        workloadPath(path,sizeof(path),&benchSizes[s],bursty);
+        if(!generateWorkload(path,benchSizes[s].vehicles,bursty)) return 1;
+        file = path;
+    }
+    Vehicle* trace;
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    size_t count = loadTrace(file,&trace);
+    if(!count){ fprintf(stderr,"%s: no vehicles to replay\n",file); return 1; }
+    double loadSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+
+    PolicyRun runs[NUM_POLICIES];
+    SDL_Thread* threads[NUM_POLICIES];
+    SDL_AtomicSet(&running,1);
+    t0 = SDL_GetPerformanceCounter();
+    for(int i=0;i<NUM_POLICIES;i++){
+        memset(&runs[i],0,sizeof(runs[i]));
+        runs[i].policy = &policies[i];
+        runs[i].trace = trace;
+        runs[i].traceLen = count;
+        runs[i].headwayMs = sim.headwayMs;
+        threads[i] = SDL_CreateThread(runPolicy,policies[i].name,&runs[i]);
+        if(!threads[i]) runPolicy(&runs[i]);
+    }
+    for(int i=0;i<NUM_POLICIES;i++) if(threads[i]) SDL_WaitThread(threads[i],NULL);
+    double wallSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+    free(trace);
+
+    printf("%s: %zu vehicles loaded in %.2f s, replayed through %d policies in %.2f s\n",
+           file,count,loadSec,NUM_POLICIES,wallSec);
+    printf("policy              throughput   mean delay    p95 delay    p99 delay  max queue    wall\n");
+    int best = -1;
+    for(int i=0;i<NUM_POLICIES;i++){
+        const PolicyRun* r = &runs[i];
+        if(!r->ok){ printf("%-18s  failed (out of memory)\n",r->policy->name); continue; }
+        printf("%-18s  %6.3f veh/s  %9.1f s  %9.1f s  %9.1f s  %9zu  %5.2f s\n",r->policy->name,
+               r->throughputVps,r->meanDelaySec,r->p95DelaySec,r->p99DelaySec,r->maxQueue,r->wallSec);
+        if(best==-1 || r->meanDelaySec<runs[best].meanDelaySec) best = i;
+    }
+    if(best!=-1) printf("lowest mean delay: %s (run it with --controller %s)\n",runs[best].policy->name,runs[best].policy->name);
+    return best==-1 ? 1 : 0;
+}
+
+// ---- City grid (--grid) ----
+//
+// A cols x rows network of junctions, each a full Simulation with its own lanes, lights and
+// policy. Neighbours are GRID_TRAVEL_MS apart and time advances in ticks no longer than that,
+// so within a tick no vehicle can reach a junction it was not already heading for. Each tick
+// steps every junction independently on the work pool. A vehicle leaving for a neighbour
+// goes into an outbox, and the neighbour collects it at the start of the next tick; each
+// junction also publishes its queues per arm, which the neighbours feeding those arms read as
+// downstream occupancy. Both alternate between two sets by tick parity, so nothing is read
+// while it is written. Every junction draws from its own random generator, so a run gives the
+// same result on any number of threads.
+
+// Column and row steps to the neighbour at each arm position clockwise from the top
+static const int gridStepCol[NUM_ROADS] = {0,1,0,-1};
+static const int gridStepRow[NUM_ROADS] = {-1,0,1,0};
+
+// Index of the neighbour at arm position pos of the junction at (col, row); -1 off the grid
+static int gridNeighbour(const Grid* g, int col, int row, int pos){
+    int c = col+gridStepCol[pos], r = row+gridStepRow[pos];
+    if(c<0 || c>=g->cols || r<0 || r>=g->rows) return -1;
+    return r*g->cols+c;
+}
+
+// Room for at least count vehicles, growing by doubling
+static bool vlReserve(VehicleList* list, size_t count){
+    if(count<=list->capacity) return true;
+    size_t cap = list->capacity ? list->capacity : 16;
+    while(cap<count) cap *= 2;
+    Vehicle* t = (Vehicle*)realloc(list->v,cap*sizeof(Vehicle));
+    if(!t) return false;
+    list->v = t;
+    list->capacity = cap;
+    return true;
+}
+
+static bool vlPush(VehicleList* list, const Vehicle* v){
+    if(!vlReserve(list,list->count+1)) return false;
+    list->v[list->count++] = *v;
+    return true;
+}
+
+// A departed vehicle drives on to the neighbour its turn leads to and joins a random lane of
+// the arm it enters by, unless its trip ends here. Called for every departure; outside
+// --grid, and at the edge of the grid, the outbox is NULL and the vehicle leaves the network.
+static void forwardVehicle(Simulation* s, const Vehicle* v){
+    int exit = (armPosition[v->road-'A']+laneTurn[v->lane-1])%NUM_ROADS;
+    VehicleList* out = s->outbox[exit];
+    if(!out || (benchRandom(&s->rng)>>33)%100<GRID_TRIP_END_PCT) return;
+    Vehicle next = *v;
+    next.road = (char)('A'+armPosition[(exit+2)%NUM_ROADS]);
+    next.lane = (int)((benchRandom(&s->rng)>>33)%NUM_LANES)+1;
+    next.arrivedMs = v->departedMs+GRID_TRAVEL_MS;
+    next.departedMs = 0;
+    if(!vlPush(out,&next)) SDL_Log("Out of memory forwarding %s", v->id);
+}
+
+// Add to junction j's input every vehicle that reaches it before untilMs: those its neighbours
+// sent during the last tick and the trips starting here. All of them arrive after what is
+// already queued, and each source is in time order already (outboxes fill in departure order),
+// so they are merged onto the end.
+static void collectArrivals(Grid* g, int j, Uint64 untilMs){
+    GridJunction* gj = &g->junction[j];
+    Simulation* s = &gj->sim;
+    VehicleList* in = &gj->inbox;
+    if(s->traceNext){
+        in->count -= s->traceNext;
+        memmove(in->v,in->v+s->traceNext,in->count*sizeof(Vehicle));
+        s->traceNext = 0;
+    }
+    VehicleList* trips = &gj->starting;
+    trips->count = 0;
+    while(gj->nextTripMs<untilMs){
+        Vehicle v;
+        benchPlate(&s->rng,v.id);
+        v.road = (char)('A'+(benchRandom(&s->rng)>>33)%NUM_ROADS);
+        v.lane = (int)((benchRandom(&s->rng)>>33)%NUM_LANES)+1;
+        v.arrivedMs = gj->nextTripMs;
+        v.departedMs = 0;
+        if(vlPush(trips,&v)) gj->trips++;
+        gj->nextTripMs += 1+(benchRandom(&s->rng)>>33)%(2*g->tripGapMs);
+    }
+
+    // merge the neighbours' outboxes and the trips; equal times are taken in that order
+    VehicleList* from[NUM_ROADS+1];
+    size_t next[NUM_ROADS+1], total = 0;
+    int sources = 0;
+    for(int pos=0;pos<NUM_ROADS;pos++){
+        int n = gridNeighbour(g,gj->col,gj->row,pos);
+        if(n>=0) from[sources++] = &g->junction[n].out[g->parity^1][(pos+2)%NUM_ROADS];
+    }
+    from[sources++] = trips;
+    for(int k=0;k<sources;k++){
+        next[k] = 0;
+        total += from[k]->count;
+    }
+    if(!vlReserve(in,in->count+total)){
+        SDL_Log("Out of memory collecting %zu vehicles", total);
+        total = 0;
+    }
+    for(size_t i=0;i<total;i++){
+        int best = -1;
+        for(int k=0;k<sources;k++)
+            if(next[k]<from[k]->count && (best<0 || from[k]->v[next[k]].arrivedMs<from[best]->v[next[best]].arrivedMs)) best = k;
+        in->v[in->count++] = from[best]->v[next[best]++];
+    }
+    for(int k=0;k<sources;k++) from[k]->count = 0;
+    s->trace = in->v;
+    s->traceLen = in->count;
+    s->inputExhausted = false;
+}
+
+// Work-pool task: one tick of junctions [begin, end)
+static void stepJunctions(void* ctx, int begin, int end){
+    Grid* g = (Grid*)ctx;
+    for(int j=begin;j<end;j++){
+        GridJunction* gj = &g->junction[j];
+        for(int pos=0;pos<NUM_ROADS;pos++){
+            int n = gridNeighbour(g,gj->col,gj->row,pos);
+            gj->sim.outbox[pos] = n<0 ? NULL : &gj->out[g->parity][pos];
+            gj->sim.exitQueue[pos] = n<0 ? NULL : &g->junction[n].armQueued[g->parity^1][(pos+2)%NUM_ROADS];
+        }
+        collectArrivals(g,j,g->tickStartMs+GRID_TRAVEL_MS);
+        advanceSimulation(&gj->sim,g->tickEndMs);
+        for(int r=0;r<NUM_ROADS;r++){
+            size_t queued = 0;
+            for(int l=0;l<NUM_LANES;l++) queued += lqSize(&gj->sim.lanes[r][l]);
+            gj->armQueued[g->parity][armPosition[r]] = (queued+NUM_LANES/2)/NUM_LANES;
+        }
+        if(g->view) fillJunctionView(&g->view->junction[j],&gj->sim);
+    }
+}
+
+// Advance the whole network to endMs, at most GRID_TRAVEL_MS past the last tick
+static void stepGrid(Grid* g, Uint64 endMs){
+    g->tickEndMs = endMs;
+    wpRun(&g->pool,g->count,GRID_GRAIN,stepJunctions,g);
+    g->tickStartMs = endMs;
+    g->parity ^= 1;
+    g->ticks++;
+}
+
+static void freeGrid(Grid* g){
+    for(int j=0;j<g->count && g->junction;j++){
+        GridJunction* gj = &g->junction[j];
+        freeSimulation(&gj->sim);
+        for(int p=0;p<2;p++)
+            for(int pos=0;pos<NUM_ROADS;pos++) free(gj->out[p][pos].v);
+        free(gj->inbox.v);
+        free(gj->starting.v);
+    }
+    free(g->junction);
+    g->junction = NULL;
+    wpFree(&g->pool);
+}
+
+// Set up every junction like sim (policy, flow) and start the pool
+static bool initGrid(Grid* g){
+    g->count = g->cols*g->rows;
+    g->tripGapMs = (Uint64)(1000/g->demand);
+    if(g->tripGapMs==0) g->tripGapMs = 1;
+    g->junction = (GridJunction*)calloc((size_t)g->count,sizeof(GridJunction));
+    if(!g->junction) return false;
+    for(int j=0;j<g->count;j++){
+        GridJunction* gj = &g->junction[j];
+        Simulation* s = &gj->sim;
+        gj->col = j%g->cols;
+        gj->row = j/g->cols;
+        s->policy = sim.policy;
+        s->headwayMs = sim.headwayMs;
+        s->rng = 0x9E3779B97F4A7C15ULL*(Uint64)(j+1);   // xorshift needs a nonzero state
+        gj->inbox.v = (Vehicle*)malloc(16*sizeof(Vehicle));   // a non-NULL trace: input comes from here
+        if(!gj->inbox.v){ freeGrid(g); return false; }
+        gj->inbox.capacity = 16;
+        s->trace = gj->inbox.v;
+        gj->nextTripMs = (benchRandom(&s->rng)>>33)%(2*g->tripGapMs);
+        startSimulation(s);
+    }
+    if(!wpInit(&g->pool,g->threads)){ freeGrid(g); return false; }
+    return true;
+}
+
+// --grid COLSxROWS
+static bool parseGrid(const char* arg){
+    int cols, rows;
+    char x;
+    if(sscanf(arg,"%d%c%d",&cols,&x,&rows)!=3 || x!='x' || cols<1 || rows<1 || cols>MAX_JUNCTIONS/rows) return false;
+    grid.cols = cols;
+    grid.rows = rows;
+    return true;
+}
+
+static void printGridReport(Grid* g, double wallSec){
+    RunStats total;
+    memset(&total,0,sizeof(total));
+    Uint64 trips = 0, waiting = 0;
+    for(int j=0;j<g->count;j++){
+        const Simulation* s = &g->junction[j].sim;
+        total.arrivals += s->stats.arrivals;
+        total.departures += s->stats.departures;
+        total.waitSumMs += s->stats.waitSumMs;
+        if(s->stats.waitMaxMs>total.waitMaxMs) total.waitMaxMs = s->stats.waitMaxMs;
+        if(s->stats.maxQueue>total.maxQueue) total.maxQueue = s->stats.maxQueue;
+        total.phases += s->stats.phases;
+        trips += g->junction[j].trips;
+        waiting += totalQueued(s);
+    }
+    double simSec = g->tickStartMs/1000.0;
+    printf("grid %dx%d: %d junctions on %d threads, simulated %.1f s in %.3f s wall (%.0fx real time)\n",
+           g->cols,g->rows,g->count,g->pool.threads,simSec,wallSec,simSec/wallSec);
+    printf("ticks: %llu of up to %.1f s, %.0f junction updates/s, %d work-pool steals\n",
+           (unsigned long long)g->ticks,GRID_TRAVEL_MS/1000.0,g->ticks*g->count/wallSec,SDL_AtomicGet(&g->pool.steals));
+    printf("trips: %llu started, %llu junction passages (%.1f per trip), %llu phases\n",
+           (unsigned long long)trips,(unsigned long long)total.arrivals,trips ? (double)total.arrivals/trips : 0.0,
+           (unsigned long long)total.phases);
+    printf("departed: %llu vehicles, %.0f per wall-clock second, mean wait %.1f s per junction, max wait %.1f s\n",
+           (unsigned long long)total.departures,total.departures/wallSec,
+           total.departures ? total.waitSumMs/1000.0/total.departures : 0.0,total.waitMaxMs/1000.0);
+    printf("longest lane queue: %zu vehicles; waiting at end: %llu vehicles\n",total.maxQueue,(unsigned long long)waiting);
+}
+
+// --grid --headless: step the network for --duration simulated seconds as fast as possible
+static void runGridHeadless(Grid* g){
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    while(g->tickStartMs<g->durationMs){
+        Uint64 end = g->tickStartMs+GRID_TRAVEL_MS;
+        stepGrid(g,end<g->durationMs ? end : g->durationMs);
+    }
+    double wallSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+    printGridReport(g,wallSec>0 ? wallSec : 1e-9);
+}
+
+// Windowed --grid: in place of manageLights(), step the network once per tick on the work
+// pool, which fills in the back snapshot as it goes, then publish it
+int manageGrid(void* arg){
+    Grid* g = &grid;
+    while(SDL_AtomicGet(&running)){
+        Uint64 step = tickStepMs();
+        ViewSnapshot* view = viewSnapshots[tbBack(&viewBuffer)];
+        g->view = view;
+        stepGrid(g,g->tickStartMs+step);
+        view->seq = g->ticks;
+        view->simMs = g->tickStartMs;
+        view->cols = g->cols;
+        view->count = g->count;
+        view->arrivals = 0;
+        view->decisionTicks = 0;
+        for(int j=0;j<g->count;j++){
+            const Simulation* s = &g->junction[j].sim;
+            view->arrivals += s->stats.arrivals;
+            if(s->decisionTicks>view->decisionTicks) view->decisionTicks = s->decisionTicks;
+        }
+        tbPublish(&viewBuffer);
+        markViewDirty();
+        waitForTick(g->tickStartMs);
+    }
+    return 0;
+}
+
+// Mark the background for redrawing; lost=true also drops the texture itself
+void invalidateBackground(bool lost){
+    if(lost && background){
+        SDL_DestroyTexture(background);
+        background = NULL;
+    }
+    backgroundDirty = true;
+}
+
+// Draw the static layer into background. Returns false if the renderer cannot
+// render to textures, in which case refreshScreen() draws it directly.
+static bool buildBackground(){
+    if(!SDL_RenderTargetSupported(renderer)) return false;
+    if(!background){
+        background = SDL_CreateTexture(renderer,SDL_PIXELFORMAT_RGBA8888,SDL_TEXTUREACCESS_TARGET,WINDOW_WIDTH,WINDOW_HEIGHT);
+        if(!background) return false;
+        SDL_SetTextureBlendMode(background,SDL_BLENDMODE_NONE); // opaque: a plain copy, no blending
+        SDL_SetTextureScaleMode(background,SDL_ScaleModeLinear);  // keeps thin lines when zoomed out
+    }
+    if(SDL_SetRenderTarget(renderer,background)<0) return false;
+    SDL_SetRenderDrawColor(renderer,255,255,255,255);
+    SDL_RenderClear(renderer);
+    drawRoads(0,0,1);
+    SDL_SetRenderTarget(renderer,NULL);
+    backgroundDirty = false;
+    return true;
+}
+
+// Static layer of every on-screen junction: one copy of the prerendered tile each, or
+// drawn directly if the renderer cannot render to textures, then its road labels
+static void drawBackground(const ViewSnapshot* view, bool prerendered){
+    int c0, c1, r0, r1;
+    if(!visibleJunctions(view,&c0,&c1,&r0,&r1)) return;
+    for(int row=r0;row<=r1;row++)
+        for(int col=c0;col<=c1;col++){
+            if(row*view->cols+col>=view->count) break;
+            SDL_FRect dst = {0,0,WINDOW_WIDTH*camera.zoom,WINDOW_HEIGHT*camera.zoom};
+            junctionOrigin(col,row,&dst.x,&dst.y);
+            if(prerendered) SDL_RenderCopyF(renderer,background,NULL,&dst);
+            else drawRoads(dst.x,dst.y,camera.zoom);
+            drawRoadLabels(dst.x,dst.y,camera.zoom);
+        }
+}
+
+// Make the snapshots big enough for a network of junctions; before any thread starts
+static bool allocView(int junctions){
+    freeView();
+    for(int i=0;i<4;i++){
+        viewSnapshots[i] = (ViewSnapshot*)calloc(1,sizeof(ViewSnapshot)+(size_t)junctions*sizeof(JunctionView));
+        if(!viewSnapshots[i]){ freeView(); return false; }
+    }
+    return true;
+}
+
+static void freeView(){
+    for(int i=0;i<4;i++){
+        free(viewSnapshots[i]);
+        viewSnapshots[i] = NULL;
+    }
+    viewCur = viewPrev = NULL;
+}
+
+// Forget every snapshot, so the first one published next is drawn without interpolating from
+// a previous run. Only while nothing is publishing.
+static void resetView(){
+    tbInit(&viewBuffer);
+    for(int i=0;i<4;i++) viewSnapshots[i]->seq = 0;
+    viewCur = viewPrev = viewSnapshots[viewBuffer.front];
+}
+
+// Renderer: take the newest snapshot, keeping the one before it to interpolate from. Until
+// there are two, both are the newest.
+static void takeLatestView(){
+    int previous, latest = tbLatestPair(&viewBuffer,&previous);
+    viewCur = viewSnapshots[latest];
+    viewPrev = viewSnapshots[previous]->seq ? viewSnapshots[previous] : viewCur;
+}
+
+// Compose the whole scene into the current render target, without presenting it
+static void drawFrame(){
+    // show the state one tick behind the clock, interpolated between the last two snapshots
+    takeLatestView();
+    if(!camera.fitted) fitCamera(viewCur);
+    bool prerendered = !backgroundDirty || buildBackground();
+    SDL_SetRenderDrawColor(renderer,0,0,0,255);
+    SDL_RenderClear(renderer);      // only visible as letterbox bars when the window aspect differs
+    SDL_SetRenderDrawColor(renderer,255,255,255,255);
+    SDL_RenderFillRect(renderer,NULL);
+    drawBackground(viewCur,prerendered);
+    Uint64 step = tickStepMs(), now = virtualNowMs();
+    float alpha = now>viewCur->simMs ? (float)(now-viewCur->simMs)/step : 0;
+    if(alpha>1 || headless) alpha = 1;
+    Uint64 shownMs = viewCur->simMs + (Uint64)(alpha*step);
+    shownMs = shownMs>step ? shownMs-step : 0;
+    viewAnimating = drawJunctions(viewPrev,viewCur,alpha,shownMs);
+    drawHud();
+}
+
+void refreshScreen(){
+    drawFrame();
+    SDL_RenderPresent(renderer);
+}
+
+// ---- Performance HUD ----
+
+// Take the once-a-second sample; returns true if one was taken
+bool sampleHud(){
+    Uint64 nowMs = SDL_GetTicks64();
+    if(nowMs-hud.lastSampleMs<HUD_SAMPLE_MS) return false;
+    double sec = (nowMs-hud.lastSampleMs)/1000.0;
+    double us = 1e6/(double)SDL_GetPerformanceFrequency();
+    takeLatestView();
+    const ViewSnapshot* view = viewCur;
+
+    hud.fps = (frameStats.frames-hud.lastFrames)/sec;
+    hud.ingestVps = view->arrivals>=hud.lastArrivals ? (view->arrivals-hud.lastArrivals)/sec : 0;
+    hud.decisionUs = view->decisionTicks*us;
+    hud.junctions = view->count;
+    hud.lastSampleMs = nowMs;
+    hud.lastFrames = frameStats.frames;
+    hud.lastArrivals = view->arrivals;
+
+    // totals over every junction
+    Uint64 queued = 0;
+    memset(hud.queued,0,sizeof(hud.queued));
+    for(int j=0;j<view->count;j++)
+        for(int r=0;r<NUM_ROADS;r++)
+            for(int l=0;l<NUM_LANES;l++){
+                hud.queued[r][l] += view->junction[j].queued[r][l];
+                queued += view->junction[j].queued[r][l];
+            }
+
+    // percentiles over the recent-frames ring; sorting a copy of 1024 values once a second is cheap
+    static Uint64 sorted[FRAME_HISTORY];
+    size_t n = frameStats.frames<FRAME_HISTORY ? (size_t)frameStats.frames : FRAME_HISTORY;
+    memcpy(sorted,frameStats.ticks,n*sizeof(Uint64));
+    qsort(sorted,n,sizeof(Uint64),compareTicks);
+    hud.frameP50Ms = n ? sorted[(n-1)/2]*us/1000 : 0;
+    hud.frameP99Ms = n ? sorted[(size_t)(0.99*(n-1))]*us/1000 : 0;
+
+    spPush(&hud.fpsLine,(float)hud.fps);
+    spPush(&hud.queuedLine,(float)queued);
+    spPush(&hud.ingestLine,(float)hud.ingestVps);
+    spPush(&hud.decisionLine,(float)hud.decisionUs);
+    return true;
+}
+
+// Overlay in the empty top-left corner. All text goes through tcDrawGlyphs(), so drawing it
+// costs one cached copy per character and never renders or allocates a texture.
+void drawHud(){
+    if(!hud.visible) return;
+    SDL_Color white = {255,255,255,255};
+    int line = hudFont ? TTF_FontLineSkip(hudFont) : 16;
+    SDL_Rect panel = {8,8,WINDOW_WIDTH/2 - ROAD_WIDTH/2 - 16,0};
+    panel.h = line*(4+NUM_ROADS+4) + 16;
+    SDL_SetRenderDrawBlendMode(renderer,SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer,0,0,0,180);
+    SDL_RenderFillRect(renderer,&panel);
+    SDL_SetRenderDrawBlendMode(renderer,SDL_BLENDMODE_NONE);
+
+    char text[64];
+    int x = panel.x+8, y = panel.y+8;
+    snprintf(text,sizeof(text),"FPS %.0f  frame p50 %.2f p99 %.2f ms",hud.fps,hud.frameP50Ms,hud.frameP99Ms);
+    tcDrawGlyphs(&hudText,text,x,y,white); y += line;
+    snprintf(text,sizeof(text),"ingest %.0f veh/s",hud.ingestVps);
+    tcDrawGlyphs(&hudText,text,x,y,white); y += line;
+    if(hud.junctions>1) snprintf(text,sizeof(text),"decision %.1f us (slowest of %d)",hud.decisionUs,hud.junctions);
+    else snprintf(text,sizeof(text),"decision %.1f us",hud.decisionUs);
+    tcDrawGlyphs(&hudText,text,x,y,white); y += line;
+    tcDrawGlyphs(&hudText,"road  lane1  lane2  lane3",x,y,white); y += line;
+    for(int r=0;r<NUM_ROADS;r++){
+        snprintf(text,sizeof(text),"%c  %6u %6u %6u",'A'+r,hud.queued[r][0],hud.queued[r][1],hud.queued[r][2]);
+        tcDrawGlyphs(&hudText,text,x,y,white); y += line;
+    }
+
+    // last 60 s, each scaled to its own maximum, which is printed beside it
+    const struct { const char* name; const Sparkline* s; } lines[4] = {
+        {"fps",&hud.fpsLine},{"queued",&hud.queuedLine},{"ingest",&hud.ingestLine},
+        {"decision",&hud.decisionLine}};
+    int labelW = 70, chartW = panel.w - 16 - labelW - 60;
+    for(int i=0;i<4;i++){
+        tcDrawGlyphs(&hudText,lines[i].name,x,y,white);
+        SDL_Rect chart = {x+labelW,y+2,chartW,line-4};
+        SDL_SetRenderDrawColor(renderer,120,230,120,255);
+        spDraw(renderer,lines[i].s,&chart);
+        snprintf(text,sizeof(text),"%.0f",spMax(lines[i].s));
+        tcDrawGlyphs(&hudText,text,chart.x+chart.w+6,y,white);
+        y += line;
+    }
+}
+
+// ---- Frame capture (--record) ----
+//
+// The simulation runs headless; an EV_FRAME every sim.frameMs of simulated time draws the
+// scene offscreen and copies the pixels out. Encoding and writing happen on a pool of worker
+// threads, so the simulation only waits if every queue slot is taken.
+
+#define CAPTURE_QUEUE 16          // frames waiting for a worker, about 30 MB at 800x800
+#define CAPTURE_MAX_WORKERS 16
+
+typedef struct {
+    Uint64 index;
+    unsigned char* pixels;        // RGB24, WINDOW_WIDTH*3 bytes per row
+} CaptureJob;
+
+typedef struct {
+    SDL_mutex* lock;
+    SDL_cond* notEmpty;
+    SDL_cond* notFull;
+    CaptureJob jobs[CAPTURE_QUEUE]; // ring
+    int head, count;
+    bool closing;
+    SDL_Thread* workers[CAPTURE_MAX_WORKERS];
+    int workerCount;
+    const char* dir;
+    bool raw;                     // write binary PPM instead of PNG
+    SDL_atomic_t written, failed;
+    Uint64 frames;                // captured, owned by the simulation thread
+    Uint64 stalls;                // times the simulation waited for a free slot
+} CapturePool;
+
+CapturePool capture;
+
+static bool writeFrame(const CaptureJob* job){
+    char path[512];
+    snprintf(path,sizeof(path),"%s/frame_%06llu.%s",capture.dir,(unsigned long long)job->index,capture.raw ? "ppm" : "png");
+    if(!capture.raw) return pngWrite(path,job->pixels,WINDOW_WIDTH,WINDOW_HEIGHT,WINDOW_WIDTH*3);
+    FILE* f = fopen(path,"wb");
+    if(!f) return false;
+    fprintf(f,"P6\n%d %d\n255\n",WINDOW_WIDTH,WINDOW_HEIGHT);
+    size_t n = (size_t)WINDOW_WIDTH*WINDOW_HEIGHT*3;
+    bool ok = fwrite(job->pixels,1,n,f)==n;
+    return fclose(f)==0 && ok;
+}
+
+static int captureWorker(void* arg){
+    (void)arg;
+    while(1){
+        SDL_LockMutex(capture.lock);
+        while(capture.count==0 && !capture.closing) SDL_CondWait(capture.notEmpty,capture.lock);
+        if(capture.count==0){ SDL_UnlockMutex(capture.lock); return 0; }
+        CaptureJob job = capture.jobs[capture.head];
+        capture.head = (capture.head+1) % CAPTURE_QUEUE;
+        capture.count--;
+        SDL_CondSignal(capture.notFull);
+        SDL_UnlockMutex(capture.lock);
+
+        if(writeFrame(&job)) SDL_AtomicAdd(&capture.written,1);
+        else SDL_AtomicAdd(&capture.failed,1);
+        free(job.pixels);
+    }
+}
+
+static void submitFrame(unsigned char* pixels){
+    SDL_LockMutex(capture.lock);
+    if(capture.count==CAPTURE_QUEUE) capture.stalls++;
+    while(capture.count==CAPTURE_QUEUE) SDL_CondWait(capture.notFull,capture.lock);
+    CaptureJob* job = &capture.jobs[(capture.head+capture.count) % CAPTURE_QUEUE];
+    job->index = capture.frames++;
+    job->pixels = pixels;
+    capture.count++;
+    SDL_CondSignal(capture.notEmpty);
+    SDL_UnlockMutex(capture.lock);
+}
+
+// Observer: on EV_FRAME, draw the current state with a clock in the corner and queue the pixels
+static void captureFrame(const Event* ev){
+    if(ev->type!=EV_FRAME || !renderer) return;
+    unsigned char* pixels = (unsigned char*)malloc((size_t)WINDOW_WIDTH*WINDOW_HEIGHT*3);
+    if(!pixels){ SDL_AtomicAdd(&capture.failed,1); return; }
+    publishView();
+    drawFrame();
+    char clock[32];
+    Uint64 sec = sim.now/1000;
+    snprintf(clock,sizeof(clock),"%02llu:%02llu:%02llu",(unsigned long long)(sec/3600),
+             (unsigned long long)(sec/60%60),(unsigned long long)(sec%60));
+    SDL_Color black = {0,0,0,255};
+    tcDrawGlyphs(&textCache,clock,10,WINDOW_HEIGHT-40,black);
+    if(SDL_RenderReadPixels(renderer,NULL,SDL_PIXELFORMAT_RGB24,pixels,WINDOW_WIDTH*3)<0){
+        free(pixels);
+        SDL_AtomicAdd(&capture.failed,1);
+        return;
+    }
+    submitFrame(pixels);
+}
+
+static bool makeDirectory(const char* dir){
+#ifdef _WIN32
+    return _mkdir(dir)==0 || errno==EEXIST;
+#else
+    return mkdir(dir,0755)==0 || errno==EEXIST;
+#endif
+}
+
+// sim --record dir: run headless, writing a frame every sim.frameMs of simulated time
+int runRecording(const char* dir, bool raw){
+    if(!makeDirectory(dir)){ perror(dir); return 1; }
+    SDL_Surface* target = openOffscreen();
+    if(!renderer){
+        SDL_Log("Software renderer unavailable: %s",SDL_GetError());
+        closeOffscreen(target);
+        return 1;
+    }
+    memset(&capture,0,sizeof(capture));
+    capture.dir = dir;
+    capture.raw = raw;
+    capture.lock = SDL_CreateMutex();
+    capture.notEmpty = SDL_CreateCond();
+    capture.notFull = SDL_CreateCond();
+    int cpus = SDL_GetCPUCount()-1;   // leave a core for the simulation
+    capture.workerCount = cpus<1 ? 1 : cpus>CAPTURE_MAX_WORKERS ? CAPTURE_MAX_WORKERS : cpus;
+    for(int i=0;i<capture.workerCount;i++) capture.workers[i] = SDL_CreateThread(captureWorker,"captureWorker",NULL);
+
+    if(!sim.frameMs) sim.frameMs = DEFAULT_FRAME_MS;
+    addObserver(captureFrame);
+    eqPush(&sim.events,0,EV_FRAME,0,0);
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    runHeadless();
+    double simSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+
+    SDL_LockMutex(capture.lock);
+    capture.closing = true;
+    SDL_CondBroadcast(capture.notEmpty);
+    SDL_UnlockMutex(capture.lock);
+    for(int i=0;i<capture.workerCount;i++) SDL_WaitThread(capture.workers[i],NULL);
+    double totalSec = (SDL_GetPerformanceCounter()-t0)/(double)SDL_GetPerformanceFrequency();
+    printf("recorded %d frames to %s (%d failed), one per %.1f simulated s; %d encoder threads, %llu stalls; "
+           "%.1f s simulating, %.1f s in total\n",
+           SDL_AtomicGet(&capture.written),dir,SDL_AtomicGet(&capture.failed),sim.frameMs/1000.0,
+           capture.workerCount,(unsigned long long)capture.stalls,simSec,totalSec);
+
+    SDL_DestroyCond(capture.notEmpty);
+    SDL_DestroyCond(capture.notFull);
+    SDL_DestroyMutex(capture.lock);
+    closeOffscreen(target);
+    return SDL_AtomicGet(&capture.failed) ? 1 : 0;
 }
@@ -0,0 +1,45 @@
+// Fixed-length history of a metric, drawn as a small line chart (one sample per second
+// gives a 60 s window).
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+#include <SDL2/SDL.h>
+
+#define SPARK_LEN 60
+
+typedef struct {
+    float v[SPARK_LEN];   // ring of samples, oldest at next once full
+    int next;
+    int count;
+} Sparkline;
+
+static inline void spPush(Sparkline* s, float value){
+    s->v[s->next] = value;
+    s->next = (s->next+1) % SPARK_LEN;
+    if(s->count<SPARK_LEN) s->count++;
+}
+
+static inline float spMax(const Sparkline* s){
+    float m = 0;
+    for(int i=0;i<s->count;i++) if(s->v[i]>m) m = s->v[i];
+    return m;
+}
+
+// Draw the history left (oldest) to right into rect, scaled so the largest sample touches
+// the top; one SDL_RenderDrawLinesF call using the current draw color
+static void spDraw(SDL_Renderer* renderer, const Sparkline* s, const SDL_Rect* rect){
+    if(s->count<2) return;
+    SDL_FPoint pts[SPARK_LEN];
+    float top = spMax(s);
+    if(top<=0) top = 1;
+    int first = s->count<SPARK_LEN ? 0 : s->next;
+    float dx = (float)rect->w/(SPARK_LEN-1);
+    for(int i=0;i<s->count;i++){
+        float value = s->v[(first+i) % SPARK_LEN];
+        pts[i].x = rect->x + (SPARK_LEN-s->count+i)*dx;   // right-aligned while filling up
+        pts[i].y = rect->y + rect->h - value/top*rect->h;
+    }
+    SDL_RenderDrawLinesF(renderer,pts,s->count);
+}
+
+#endif
@@ -0,0 +1,79 @@
+// Lock-free single-producer/single-consumer ring that carries vehicles from
+// the ingest thread to the controller thread.
+//
+// The producer fills slots and publishes them in one go by advancing tail;
+// the consumer reads them and hands the slots back by advancing head. Each
+// index is written by exactly one thread, so no locks or CAS loops are needed.
+// Indices are free-running 32-bit counters masked on access.
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include "lane_queue.h"
+
+#define RING_CAPACITY (1<<16)        // must be a power of two
+#define RING_RESET_ROAD 0            // Vehicle.road of a marker telling the consumer to clear its queues
+
+typedef struct {
+    Vehicle v;
+    Uint64 pushedAt;   // SDL_GetPerformanceCounter() at publish time, for handoff latency
+} RingSlot;
+
+typedef struct {
+    SDL_atomic_t tail;                 // written by the producer only
+    char pad0[64-sizeof(SDL_atomic_t)]; // keep the two indices on separate cache lines
+    SDL_atomic_t head;                 // written by the consumer only
+    char pad1[64-sizeof(SDL_atomic_t)];
+    unsigned pending;                  // producer-private: slots filled but not yet published
+    RingSlot* slots;
+} VehicleRing;
+
+static inline bool ringInit(VehicleRing* r){
+    memset(r,0,sizeof(*r));
+    r->slots = (RingSlot*)malloc(RING_CAPACITY*sizeof(RingSlot));
+    return r->slots!=NULL;
+}
+
+static inline void ringFree(VehicleRing* r){
+    free(r->slots);
+    r->slots = NULL;
+}
+
+// Producer: next free slot, or NULL if the ring is full (publish and retry later)
+static inline RingSlot* ringReserve(VehicleRing* r){
+    unsigned tail = (unsigned)SDL_AtomicGet(&r->tail) + r->pending;
+    if(tail - (unsigned)SDL_AtomicGet(&r->head) >= RING_CAPACITY) return NULL;
+    r->pending++;
+    return &r->slots[tail & (RING_CAPACITY-1)];
+}
+
+// Producer: make every reserved slot visible to the consumer. Returns how many were published.
+static inline unsigned ringPublish(VehicleRing* r){
+    unsigned n = r->pending;
+    if(!n) return 0;
+    Uint64 now = SDL_GetPerformanceCounter();
+    unsigned tail = (unsigned)SDL_AtomicGet(&r->tail);
+    for(unsigned i=0;i<n;i++) r->slots[(tail+i) & (RING_CAPACITY-1)].pushedAt = now;
+    SDL_AtomicSet(&r->tail,(int)(tail+n)); // full barrier: slot writes happen-before the new tail
+    r->pending = 0;
+    return n;
+}
+
+// Consumer: number of published slots not yet consumed; *first receives the index of the oldest
+static inline unsigned ringAcquire(VehicleRing* r, unsigned* first){
+    *first = (unsigned)SDL_AtomicGet(&r->head);
+    return (unsigned)SDL_AtomicGet(&r->tail) - *first;
+}
+
+// Consumer: slot at index i, for first <= i < first+ringAcquire()
+static inline const RingSlot* ringSlot(const VehicleRing* r, unsigned i){
+    return &r->slots[i & (RING_CAPACITY-1)];
+}
+
+// Consumer: hand n slots back to the producer
+static inline void ringRelease(VehicleRing* r, unsigned n){
+    SDL_AtomicAdd(&r->head,(int)n);
+}
+
+#endif
@@ -0,0 +1,142 @@
+// Cache of rendered text labels, so a string is rasterised once and then drawn
+// with a single SDL_RenderCopy per frame.
+//
+// Entries are keyed by (string, color) and live until the cache is full, when
+// the least recently drawn one is replaced. Labels that change every frame
+// (counters) just cycle through the slots; static labels stay resident.
+// Textures belong to one renderer: call tcClear() if the renderer is recreated
+// or reports SDL_RENDER_DEVICE_RESET.
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define TC_SLOTS 64
+#define TC_KEY_MAX 48      // longer strings are rendered uncached
+
+typedef struct {
+    char key[TC_KEY_MAX];
+    Uint32 hash;
+    Uint32 color;          // RGBA packed
+    SDL_Texture* tex;      // NULL = free slot
+    int w, h;
+    Uint64 lastUsed;
+} TextEntry;
+
+typedef struct {
+    SDL_Renderer* renderer;
+    TTF_Font* font;
+    TextEntry entries[TC_SLOTS];
+    Uint64 clock;          // bumped per lookup, for LRU
+    Uint64 hits;
+    Uint64 misses;
+} TextCache;
+
+static inline Uint32 tcHash(const char* s, size_t n){
+    Uint32 h = 2166136261u;  // FNV-1a
+    for(size_t i=0;i<n;i++){ h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+static inline Uint32 tcPackColor(SDL_Color c){
+    return (Uint32)c.r<<24 | (Uint32)c.g<<16 | (Uint32)c.b<<8 | c.a;
+}
+
+static inline void tcInit(TextCache* c, SDL_Renderer* renderer, TTF_Font* font){
+    memset(c,0,sizeof(*c));
+    c->renderer = renderer;
+    c->font = font;
+}
+
+// Destroy every texture but keep the renderer and font
+static inline void tcClear(TextCache* c){
+    for(int i=0;i<TC_SLOTS;i++){
+        if(c->entries[i].tex) SDL_DestroyTexture(c->entries[i].tex);
+        c->entries[i].tex = NULL;
+    }
+}
+
+static inline void tcFree(TextCache* c){
+    tcClear(c);
+    c->renderer = NULL;
+    c->font = NULL;
+}
+
+static SDL_Texture* tcRender(TextCache* c, const char* text, SDL_Color color, int* w, int* h){
+    SDL_Surface* surf = TTF_RenderText_Solid(c->font,text,color);
+    if(!surf) return NULL;
+    SDL_Texture* tex = SDL_CreateTextureFromSurface(c->renderer,surf);
+    *w = surf->w;
+    *h = surf->h;
+    SDL_FreeSurface(surf);
+    return tex;
+}
+
+// Texture for text in color, rendering it on a miss. NULL if the font is missing,
+// the text is empty or rendering failed. Uncacheable (over-long) text is drawn
+// directly by tcDraw() instead.
+static SDL_Texture* tcLookup(TextCache* c, const char* text, SDL_Color color, int* w, int* h){
+    size_t n = strlen(text);
+    if(!c->font || !c->renderer || n==0 || n>=TC_KEY_MAX) return NULL;
+    Uint32 hash = tcHash(text,n), rgba = tcPackColor(color);
+    TextEntry* victim = &c->entries[0];
+    c->clock++;
+    for(int i=0;i<TC_SLOTS;i++){
+        TextEntry* e = &c->entries[i];
+        if(e->tex && e->hash==hash && e->color==rgba && strcmp(e->key,text)==0){
+            e->lastUsed = c->clock;
+            c->hits++;
+            *w = e->w;
+            *h = e->h;
+            return e->tex;
+        }
+        if(!victim->tex) continue;
+        if(!e->tex || e->lastUsed<victim->lastUsed) victim = e;
+    }
+    c->misses++;
+    if(victim->tex) SDL_DestroyTexture(victim->tex);
+    victim->tex = tcRender(c,text,color,&victim->w,&victim->h);
+    if(!victim->tex) return NULL;
+    memcpy(victim->key,text,n+1);
+    victim->hash = hash;
+    victim->color = rgba;
+    victim->lastUsed = c->clock;
+    *w = victim->w;
+    *h = victim->h;
+    return victim->tex;
+}
+
+// Draw text with its top-left corner at (x, y)
+static void tcDraw(TextCache* c, const char* text, int x, int y, SDL_Color color){
+    SDL_Rect dst = {x,y,0,0};
+    SDL_Texture* tex = tcLookup(c,text,color,&dst.w,&dst.h);
+    if(tex){
+        SDL_RenderCopy(c->renderer,tex,NULL,&dst);
+        return;
+    }
+    if(!c->font || !c->renderer || strlen(text)<TC_KEY_MAX) return;
+    tex = tcRender(c,text,color,&dst.w,&dst.h);
+    if(!tex) return;
+    SDL_RenderCopy(c->renderer,tex,NULL,&dst);
+    SDL_DestroyTexture(tex);
+}
+
+// Draw text one cached character at a time (no kerning). For strings that change every
+// frame, such as counters: after the first few frames nothing is rendered or allocated,
+// as long as fewer than TC_SLOTS distinct characters are in use.
+static void tcDrawGlyphs(TextCache* c, const char* text, int x, int y, SDL_Color color){
+    char glyph[2] = {0,0};
+    for(const char* p=text;*p;p++){
+        glyph[0] = *p;
+        SDL_Rect dst = {x,y,0,0};
+        SDL_Texture* tex = tcLookup(c,glyph,color,&dst.w,&dst.h);
+        if(!tex) continue;
+        SDL_RenderCopy(c->renderer,tex,NULL,&dst);
+        x += dst.w;
+    }
+}
+
+#endif
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <windows.h>  // For Sleep()
+#include "vehicle_log.h"
 
 #define FILENAME "vehicles.data"
 
@@ -29,8 +31,35 @@ int generateLane() {
     return (rand() % 3) + 1;
 }
 
-int main() {
-    FILE* file = fopen(FILENAME, "a");
+// Open FILENAME for appending binary records, writing the header if the file is new.
+// Returns NULL if the file already holds text records.
+FILE* openBinaryLog(uint64_t* baseTimeMs) {
+    FILE* file = fopen(FILENAME, "a+b");
+    if (!file) return NULL;
+
+    unsigned char header[VLOG_HEADER_SIZE];
+    size_t n = fread(header, 1, sizeof(header), file);
+    VlogHeader h;
+    fseek(file, 0, SEEK_END); // required between a read and a write on the same stream
+    if (n == 0) {
+        *baseTimeMs = vlogNowMs();
+        vlogWriteHeader(file, *baseTimeMs);
+    } else if (vlogDecodeHeader(header, n, &h)) {
+        *baseTimeMs = h.baseTimeMs;
+    } else {
+        fprintf(stderr, "%s exists and is not a version %d binary log\n", FILENAME, VLOG_VERSION);
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+int main(int argc, char* argv[]) {
+    // --binary appends fixed-size records (see vehicle_log.h) instead of text lines
+    int binary = argc > 1 && strcmp(argv[1], "--binary") == 0;
+    uint64_t baseTimeMs = 0;
+
+    FILE* file = binary ? openBinaryLog(&baseTimeMs) : fopen(FILENAME, "a");
     if (!file) {
         perror("Error opening file");
         return 1;
@@ -44,8 +73,12 @@ int main() {
         char road = generateRoad();
         int lane = generateLane();
 
-        // Format: ROAD LANE VEHICLE_ID
-        fprintf(file, "%c %d %s\n", road, lane, vehicle);
+        if (binary) {
+            vlogWriteRecord(file, road, lane, vehicle, (uint32_t)(vlogNowMs() - baseTimeMs));
+        } else {
+            // Format: ROAD LANE VEHICLE_ID
+            fprintf(file, "%c %d %s\n", road, lane, vehicle);
+        }
         fflush(file);
 
         printf("Generated: %c %d %s\n", road, lane, vehicle);
@@ -0,0 +1,64 @@
+// Lock-free triple buffer index: one writer publishes complete snapshots, one
+// reader always gets the newest complete one, and neither ever waits.
+//
+// The caller owns three snapshot buffers; this only tracks which is which.
+// The writer fills buffers[tbBack()] and calls tbPublish(), which swaps it with
+// the "middle" buffer in one atomic exchange. The reader's tbLatest() swaps the
+// middle buffer with its own front buffer if a newer one was published since the
+// last call. The buffer the reader holds is never handed to the writer, so a
+// snapshot cannot change while it is being drawn.
+// A reader that interpolates between the two newest snapshots uses a fourth
+// buffer and tbLatestPair(), which keeps the one it held before as well.
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <SDL2/SDL.h>
+
+#define TB_FRESH 4   // set in middle when it holds a snapshot the reader has not taken
+
+typedef struct {
+    SDL_atomic_t middle;   // index of the latest published buffer, | TB_FRESH
+    int back;              // writer-private: buffer being filled
+    int front;             // reader-private: buffer being read
+    int previous;          // reader-private, tbLatestPair() only: the front before the last swap
+} TripleBuffer;
+
+static inline void tbInit(TripleBuffer* tb){
+    SDL_AtomicSet(&tb->middle,1);
+    tb->back = 0;
+    tb->front = 2;
+    tb->previous = 3;
+}
+
+// Writer: index of the buffer to fill. Its old contents are stale, so fill every field.
+static inline int tbBack(const TripleBuffer* tb){
+    return tb->back;
+}
+
+// Writer: publish the back buffer; returns the index of the next one to fill
+static inline int tbPublish(TripleBuffer* tb){
+    tb->back = SDL_AtomicSet(&tb->middle,tb->back|TB_FRESH) & 3; // full barrier: the fill happens-before
+    return tb->back;
+}
+
+// Reader: index of the newest complete snapshot, valid until the next call
+static inline int tbLatest(TripleBuffer* tb){
+    if(SDL_AtomicGet(&tb->middle) & TB_FRESH)
+        tb->front = SDL_AtomicSet(&tb->middle,tb->front) & 3;
+    return tb->front;
+}
+
+// Reader with four buffers: index of the newest complete snapshot, and in *previous the one
+// the reader held before it, both valid until the next call. The older of the two goes back
+// to the writer in exchange for the new one.
+static inline int tbLatestPair(TripleBuffer* tb, int* previous){
+    if(SDL_AtomicGet(&tb->middle) & TB_FRESH){
+        int newest = SDL_AtomicSet(&tb->middle,tb->previous) & 3;
+        tb->previous = tb->front;
+        tb->front = newest;
+    }
+    *previous = tb->previous;
+    return tb->front;
+}
+
+#endif
@@ -0,0 +1,193 @@
+// Self-check for the vehicle file formats, no display needed:
+//  1. the memory-mapped SIMD scanner in vehicle_parse.h reads exactly the records the old
+//     fgets + sscanf loop read, on generator output mixed with irregular lines;
+//  2. text -> binary -> text through vehicle_convert gives back the same records.
+//
+//   gcc -O2 vehicle_convert.c -o vehicle_convert
+//   gcc -O2 vehicle_check.c -o vehicle_check && ./vehicle_check [path to vehicle_convert]
+//   (add -mavx2 to the second line to check the AVX2 newline scan too)
+//
+// Prints one line per check and exits non-zero if any fails.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vehicle_parse.h"
+
+#define CHECK_TEXT "check_vehicles.data"
+#define CHECK_VLOG "check_vehicles.vlog"
+#define CHECK_BACK "check_vehicles_back.data"
+#define CHECK_LINES 200000
+
+typedef struct {
+    char road;
+    int lane;
+    char id[VP_ID_MAX+1];
+} Record;
+
+typedef struct {
+    Record* r;
+    size_t count, capacity;
+} RecordList;
+
+static void push(RecordList* list, char road, int lane, const char* id){
+    if(list->count==list->capacity){
+        list->capacity = list->capacity ? list->capacity*2 : 1024;
+        list->r = (Record*)realloc(list->r,list->capacity*sizeof(Record));
+        if(!list->r){ fprintf(stderr,"out of memory\n"); exit(1); }
+    }
+    Record* r = &list->r[list->count++];
+    r->road = road;
+    r->lane = lane;
+    snprintf(r->id,sizeof(r->id),"%s",id);
+}
+
+static unsigned long long seed = 42;
+static unsigned nextRandom(unsigned n){
+    seed = seed*6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(seed>>33)%n;
+}
+
+static void randomId(char* id){
+    static const char pat[9] = "AA0AA000";
+    for(int i=0;i<8;i++) id[i] = pat[i]=='A' ? (char)('A'+nextRandom(26)) : (char)('0'+nextRandom(10));
+    id[8] = 0;
+}
+
+// Mostly traffic_generator.c lines, so the SIMD fast path runs, with every few lines one the
+// scalar fallback has to handle: other spacing, CRLF, signs, short, long or missing fields
+static void writeMixed(FILE* f){
+    static const char* odd[] = {
+        "A  2 AB1CD234\n", "B\t1\tXY9ZW000\n", "C 3 AB1CD234\r\n", "D 2 AB1\n", "A 4 AB1CD234\n",
+        "E 1 AB1CD234\n", "a 2 ab1cd234\n", "B -2 NEG00001\n", "C +3 POS00001\n", "D 12 LONGLANE\n",
+        "A 2 TOOLONGPLATE123\n", "B 2\n", "C\n", "\n", "D x AB1CD234\n", "A2 AB1CD234\n",
+        "B 1 AB1CD234 trailing\n", " 3 AB1CD234\n", "C 2  AB1CD234\n", "D 1 AB1CD2345\n",
+    };
+    char id[9];
+    for(int i=0;i<CHECK_LINES;i++){
+        if(nextRandom(8)==0) fputs(odd[nextRandom(sizeof(odd)/sizeof(odd[0]))],f);
+        else{
+            randomId(id);
+            fprintf(f,"%c %d %s\n","ABCD"[nextRandom(4)],(int)nextRandom(3)+1,id);
+        }
+    }
+}
+
+// Only what the simulator accepts and a binary log can hold: roads A-D, lanes 1-3, 8-char plates
+static void writeValid(FILE* f){
+    char id[9];
+    for(int i=0;i<CHECK_LINES;i++){
+        randomId(id);
+        if(nextRandom(8)==0) id[1+nextRandom(7)] = 0;   // shorter plates are padded in the log
+        fprintf(f,"%c %d %s\n","ABCD"[nextRandom(4)],(int)nextRandom(3)+1,id);
+    }
+}
+
+static bool writeFile(const char* path, void (*fill)(FILE*)){
+    FILE* f = fopen(path,"wb");
+    if(!f){ perror(path); return false; }
+    fill(f);
+    return fclose(f)==0;
+}
+
+// The parser simulator.c used before vehicle_parse.h
+static RecordList readSscanf(const char* path){
+    RecordList list = {0};
+    FILE* f = fopen(path,"rb");
+    if(!f) return list;
+    char line[50], road, id[VP_ID_MAX+1];
+    int lane;
+    while(fgets(line,sizeof(line),f)){
+        line[strcspn(line,"\n")] = 0;
+        if(sscanf(line,"%c %d %9s",&road,&lane,id)==3) push(&list,road,lane,id);
+    }
+    fclose(f);
+    return list;
+}
+
+static RecordList readMapped(const char* path){
+    RecordList list = {0};
+    FILE* f = fopen(path,"rb");
+    if(!f) return list;
+    fseek(f,0,SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    MappedFile m;
+    if(size<=0 || !mapFile(&m,path,0,(size_t)size)) return list;
+    VehicleScanner sc;
+    vsInit(&sc,m.data,m.len);
+    char road, id[VP_ID_MAX+1];
+    int lane, r;
+    while((r=vsNext(&sc,&road,&lane,id))>=0)
+        if(r) push(&list,road,lane,id);
+    unmapFile(&m);
+    return list;
+}
+
+// Report the first difference, if any
+static bool sameRecords(const char* what, const RecordList* a, const RecordList* b){
+    size_t n = a->count<b->count ? a->count : b->count;
+    for(size_t i=0;i<n;i++){
+        const Record* x = &a->r[i];
+        const Record* y = &b->r[i];
+        if(x->road!=y->road || x->lane!=y->lane || strcmp(x->id,y->id)!=0){
+            printf("FAIL %s: record %zu is '%c %d %s' vs '%c %d %s'\n",what,i,x->road,x->lane,x->id,y->road,y->lane,y->id);
+            return false;
+        }
+    }
+    if(a->count!=b->count){
+        printf("FAIL %s: %zu records vs %zu\n",what,a->count,b->count);
+        return false;
+    }
+    printf("ok   %s: %zu records\n",what,a->count);
+    return true;
+}
+
+static bool checkParsers(){
+    if(!writeFile(CHECK_TEXT,writeMixed)) return false;
+    RecordList a = readSscanf(CHECK_TEXT), b = readMapped(CHECK_TEXT);
+    bool ok = sameRecords("fgets+sscanf vs mmap+simd",&a,&b);
+    free(a.r);
+    free(b.r);
+    return ok;
+}
+
+static bool checkRoundTrip(const char* convert){
+    if(!writeFile(CHECK_TEXT,writeValid)) return false;
+    char cmd[512];
+    snprintf(cmd,sizeof(cmd),"\"%s\" text2bin %s %s >%s",convert,CHECK_TEXT,CHECK_VLOG,
+#ifdef _WIN32
+             "NUL");
+#else
+             "/dev/null");
+#endif
+    if(system(cmd)!=0){ printf("FAIL round trip: %s\n",cmd); return false; }
+    snprintf(cmd,sizeof(cmd),"\"%s\" bin2text %s %s >%s",convert,CHECK_VLOG,CHECK_BACK,
+#ifdef _WIN32
+             "NUL");
+#else
+             "/dev/null");
+#endif
+    if(system(cmd)!=0){ printf("FAIL round trip: %s\n",cmd); return false; }
+    RecordList a = readSscanf(CHECK_TEXT), b = readSscanf(CHECK_BACK);
+    bool ok = sameRecords("text -> vlog -> text",&a,&b);
+    free(a.r);
+    free(b.r);
+    return ok;
+}
+
+int main(int argc, char* argv[]){
+#if defined(VP_AVX2)
+    printf("parser: AVX2 newline scan, SSE2 layout check\n");
+#elif defined(VP_SSE2)
+    printf("parser: SSE2\n");
+#else
+    printf("parser: scalar\n");
+#endif
+    const char* convert = argc>1 ? argv[1] : "./vehicle_convert";
+    bool ok = checkParsers();
+    ok = checkRoundTrip(convert) && ok;
+    remove(CHECK_TEXT);
+    remove(CHECK_VLOG);
+    remove(CHECK_BACK);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// Convert vehicle logs between the text format and the binary format (vehicle_log.h)
+//
+//   gcc -O2 vehicle_convert.c -o vehicle_convert
+//   ./vehicle_convert text2bin vehicles.data vehicles.vlog [interval_ms]
+//   ./vehicle_convert bin2text vehicles.vlog vehicles.data
+//
+// Text lines carry no time, so text2bin stamps record i with i*interval_ms
+// (default 1000, the rate traffic_generator.c writes at). bin2text drops the
+// timestamps.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vehicle_parse.h"
+#include "vehicle_log.h"
+
+#define IO_BUFFER (1<<20)
+
+static long long fileSize(const char* path){
+    FILE* f = fopen(path,"rb");
+    if(!f) return -1;
+#ifdef _WIN32
+    _fseeki64(f,0,SEEK_END);
+    long long n = _ftelli64(f);
+#else
+    fseeko(f,0,SEEK_END);
+    long long n = (long long)ftello(f);
+#endif
+    fclose(f);
+    return n;
+}
+
+static int textToBinary(const char* in, const char* out, uint32_t intervalMs){
+    long long size = fileSize(in);
+    if(size<0){ perror(in); return 1; }
+    FILE* f = fopen(out,"wb");
+    if(!f){ perror(out); return 1; }
+    setvbuf(f,NULL,_IOFBF,IO_BUFFER);
+    vlogWriteHeader(f,vlogNowMs());
+
+    long long records = 0, skipped = 0;
+    MappedFile m;
+    if(size>0 && mapFile(&m,in,0,(size_t)size)){
+        VehicleScanner sc;
+        vsInit(&sc,m.data,m.len);
+        char road = 0, id[VP_ID_MAX+1];
+        int lane = 0, r;
+        while((r=vsNext(&sc,&road,&lane,id))>=0){
+            if(r==0 || road<'A' || road>'D'){ skipped++; continue; }
+            vlogWriteRecord(f,road,lane,id,(uint32_t)(records*intervalMs));
+            records++;
+        }
+        if(vsConsumed(&sc,m.data)<m.len) skipped++; // unterminated last line
+        unmapFile(&m);
+    }
+    if(fclose(f)!=0){ perror(out); return 1; }
+    printf("%lld records written, %lld lines skipped\n",records,skipped);
+    return 0;
+}
+
+static int binaryToText(const char* in, const char* out){
+    FILE* src = fopen(in,"rb");
+    if(!src){ perror(in); return 1; }
+    unsigned char header[VLOG_HEADER_SIZE];
+    VlogHeader h;
+    if(!vlogDecodeHeader(header,fread(header,1,sizeof(header),src),&h)){
+        fprintf(stderr,"%s is not a version %d binary log\n",in,VLOG_VERSION);
+        fclose(src);
+        return 1;
+    }
+    FILE* dst = fopen(out,"w");
+    if(!dst){ perror(out); fclose(src); return 1; }
+    setvbuf(dst,NULL,_IOFBF,IO_BUFFER);
+
+    static unsigned char buf[VLOG_RECORD_SIZE*4096];
+    long long records = 0, skipped = 0;
+    size_t n;
+    while((n=fread(buf,VLOG_RECORD_SIZE,sizeof(buf)/VLOG_RECORD_SIZE,src))>0){
+        for(size_t i=0;i<n;i++){
+            VlogRecord r;
+            if(!vlogDecodeRecord(buf+i*VLOG_RECORD_SIZE,&r)){ skipped++; continue; }
+            fprintf(dst,"%c %d %s\n",r.road,r.lane,r.plate);
+            records++;
+        }
+    }
+    fclose(src);
+    if(fclose(dst)!=0){ perror(out); return 1; }
+    printf("%lld records written, %lld records skipped\n",records,skipped);
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+    if(argc>=4 && strcmp(argv[1],"text2bin")==0)
+        return textToBinary(argv[2],argv[3],argc>4 ? (uint32_t)strtoul(argv[4],NULL,10) : 1000);
+    if(argc>=4 && strcmp(argv[1],"bin2text")==0)
+        return binaryToText(argv[2],argv[3]);
+    fprintf(stderr,"usage: %s text2bin <in.data> <out.vlog> [interval_ms]\n"
+                   "       %s bin2text <in.vlog> <out.data>\n",argv[0],argv[0]);
+    return 2;
+}
@@ -0,0 +1,116 @@
+// Binary vehicle log: a compact alternative to the "ROAD LANE ID" text lines.
+//
+// Layout (all integers little-endian):
+//   header, 16 bytes:  "VLOG" | u16 version | u16 record size | u64 base time (ms since Unix epoch)
+//   record, 16 bytes:  plate[8] | u32 time (ms after base) | u8 road (0=A..3=D) | u8 lane | u16 reserved
+//
+// Plates shorter than 8 characters are padded with '\0'. A u32 millisecond
+// offset lets one log span about 49 days.
+#ifndef VEHICLE_LOG_H
+#define VEHICLE_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define VLOG_MAGIC "VLOG"
+#define VLOG_VERSION 1
+#define VLOG_HEADER_SIZE 16
+#define VLOG_RECORD_SIZE 16
+#define VLOG_PLATE_LEN 8
+
+typedef struct {
+    uint16_t version;
+    uint16_t recordSize;
+    uint64_t baseTimeMs;
+} VlogHeader;
+
+typedef struct {
+    char plate[VLOG_PLATE_LEN + 1]; // NUL-terminated copy
+    uint32_t timeMs;                // ms after the header's base time
+    char road;                      // 'A'..'D'
+    uint8_t lane;
+} VlogRecord;
+
+static inline void vlogPut16(unsigned char* p, uint16_t v){ p[0]=(unsigned char)v; p[1]=(unsigned char)(v>>8); }
+static inline void vlogPut32(unsigned char* p, uint32_t v){ for(int i=0;i<4;i++) p[i]=(unsigned char)(v>>(8*i)); }
+static inline void vlogPut64(unsigned char* p, uint64_t v){ for(int i=0;i<8;i++) p[i]=(unsigned char)(v>>(8*i)); }
+static inline uint16_t vlogGet16(const unsigned char* p){ return (uint16_t)(p[0] | p[1]<<8); }
+static inline uint32_t vlogGet32(const unsigned char* p){ return (uint32_t)p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24; }
+static inline uint64_t vlogGet64(const unsigned char* p){ return (uint64_t)vlogGet32(p) | (uint64_t)vlogGet32(p+4)<<32; }
+
+// Wall-clock time in ms since the Unix epoch
+static inline uint64_t vlogNowMs(){
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime<<32) | ft.dwLowDateTime; // 100 ns since 1601
+    return t/10000 - 11644473600000ULL;
+#else
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return (uint64_t)tv.tv_sec*1000 + (uint64_t)tv.tv_usec/1000;
+#endif
+}
+
+// True if buf (at least 4 bytes) starts a binary log
+static inline bool vlogIsLog(const void* buf, size_t len){
+    return len>=4 && memcmp(buf,VLOG_MAGIC,4)==0;
+}
+
+static inline void vlogEncodeHeader(unsigned char* out, uint64_t baseTimeMs){
+    memcpy(out,VLOG_MAGIC,4);
+    vlogPut16(out+4,VLOG_VERSION);
+    vlogPut16(out+6,VLOG_RECORD_SIZE);
+    vlogPut64(out+8,baseTimeMs);
+}
+
+// Returns false if buf is not a header this reader understands
+static inline bool vlogDecodeHeader(const unsigned char* in, size_t len, VlogHeader* h){
+    if(len<VLOG_HEADER_SIZE || !vlogIsLog(in,len)) return false;
+    h->version = vlogGet16(in+4);
+    h->recordSize = vlogGet16(in+6);
+    h->baseTimeMs = vlogGet64(in+8);
+    return h->version==VLOG_VERSION && h->recordSize==VLOG_RECORD_SIZE;
+}
+
+static inline void vlogEncodeRecord(unsigned char* out, char road, int lane, const char* plate, uint32_t timeMs){
+    memset(out,0,VLOG_RECORD_SIZE);
+    size_t n = strlen(plate);
+    memcpy(out,plate,n<VLOG_PLATE_LEN ? n : VLOG_PLATE_LEN);
+    vlogPut32(out+8,timeMs);
+    out[12] = (unsigned char)(road-'A');
+    out[13] = (unsigned char)lane;
+}
+
+// Returns false for a record with an out-of-range road
+static inline bool vlogDecodeRecord(const unsigned char* in, VlogRecord* r){
+    memcpy(r->plate,in,VLOG_PLATE_LEN);
+    r->plate[VLOG_PLATE_LEN] = 0;
+    r->timeMs = vlogGet32(in+8);
+    r->road = (char)('A'+in[12]);
+    r->lane = in[13];
+    return in[12]<4;
+}
+
+// Write a header to a freshly created (empty) log
+static inline bool vlogWriteHeader(FILE* f, uint64_t baseTimeMs){
+    unsigned char h[VLOG_HEADER_SIZE];
+    vlogEncodeHeader(h,baseTimeMs);
+    return fwrite(h,1,sizeof(h),f)==sizeof(h);
+}
+
+static inline bool vlogWriteRecord(FILE* f, char road, int lane, const char* plate, uint32_t timeMs){
+    unsigned char r[VLOG_RECORD_SIZE];
+    vlogEncodeRecord(r,road,lane,plate,timeMs);
+    return fwrite(r,1,sizeof(r),f)==sizeof(r);
+}
+
+#endif
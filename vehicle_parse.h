@@ -0,0 +1,200 @@
+// Fast reader for the "ROAD LANE ID" text records written by traffic_generator.c
+//
+//   A 2 IR2JO020\n
+//
+// The file is memory-mapped and scanned in place. Lines in the exact layout
+// above (road A-D, lane 1-3, 2 letters + digit + 2 letters + 3 digits) are
+// validated with one 16-byte SIMD compare; anything else falls back to a
+// scalar parser that accepts what sscanf("%c %d %s") used to accept.
+//
+// Build with -mavx2 to use AVX2 for newline scanning; SSE2 is used on any
+// x86-64 target, and other targets get the scalar code.
+#ifndef VEHICLE_PARSE_H
+#define VEHICLE_PARSE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VP_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VP_SSE2 1
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define VP_RECORD_LEN 13   // "A 2 IR2JO020\n"
+#define VP_ID_MAX 9        // longest id copied out, excluding the terminator
+
+// Read-only view of [offset, offset+len) of a file
+typedef struct {
+    const char* data;  // first requested byte
+    size_t len;
+    void* base;        // start of the actual mapping (page aligned)
+    size_t mapLen;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} MappedFile;
+
+// Map len bytes of path starting at offset. Returns false (and an empty view) on failure or len==0.
+static bool mapFile(MappedFile* m, const char* path, unsigned long long offset, size_t len){
+    memset(m,0,sizeof(*m));
+    if(len==0) return false;
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    unsigned long long start = offset - offset % si.dwAllocationGranularity;
+    size_t skip = (size_t)(offset-start);
+    m->file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(m->file==INVALID_HANDLE_VALUE) return false;
+    m->mapping = CreateFileMappingA(m->file,NULL,PAGE_READONLY,0,0,NULL);
+    if(!m->mapping){ CloseHandle(m->file); return false; }
+    m->base = MapViewOfFile(m->mapping,FILE_MAP_READ,(DWORD)(start>>32),(DWORD)start,skip+len);
+    if(!m->base){ CloseHandle(m->mapping); CloseHandle(m->file); return false; }
+#else
+    long page = sysconf(_SC_PAGESIZE);
+    unsigned long long start = offset - offset % (unsigned long long)page;
+    size_t skip = (size_t)(offset-start);
+    int fd = open(path,O_RDONLY);
+    if(fd<0) return false;
+    void* p = mmap(NULL,skip+len,PROT_READ,MAP_PRIVATE,fd,(off_t)start);
+    close(fd);
+    if(p==MAP_FAILED) return false;
+    madvise(p,skip+len,MADV_SEQUENTIAL);
+    m->base = p;
+#endif
+    m->mapLen = skip+len;
+    m->data = (const char*)m->base + skip;
+    m->len = len;
+    return true;
+}
+
+static void unmapFile(MappedFile* m){
+    if(!m->base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m->base);
+    CloseHandle(m->mapping);
+    CloseHandle(m->file);
+#else
+    munmap(m->base,m->mapLen);
+#endif
+    memset(m,0,sizeof(*m));
+}
+
+static inline int vpCtz(unsigned mask){
+#ifdef _MSC_VER
+    unsigned long i; _BitScanForward(&i,mask); return (int)i;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// First '\n' in [p,end), or NULL
+static inline const char* vpFindNewline(const char* p, const char* end){
+#ifdef VP_AVX2
+    const __m256i nl32 = _mm256_set1_epi8('\n');
+    while(end-p >= 32){
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p),nl32));
+        if(mask) return p + vpCtz(mask);
+        p += 32;
+    }
+#endif
+#ifdef VP_SSE2
+    const __m128i nl16 = _mm_set1_epi8('\n');
+    while(end-p >= 16){
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p),nl16));
+        if(mask) return p + vpCtz(mask);
+        p += 16;
+    }
+#endif
+    return (const char*)memchr(p,'\n',(size_t)(end-p));
+}
+
+// Check that the 16 bytes at p start with a well-formed fixed-layout record
+static inline bool vpIsFixedRecord(const char* p){
+#ifdef VP_SSE2
+    // per-position inclusive bounds; the last three bytes belong to the next record and are unconstrained
+    static const char lo[16] = {'A',' ','1',' ','A','A','0','A','A','0','0','0','\n',0,0,0};
+    static const char hi[16] = {'D',' ','3',' ','Z','Z','9','Z','Z','9','9','9','\n',(char)0xff,(char)0xff,(char)0xff};
+    __m128i x = _mm_loadu_si128((const __m128i*)p);
+    __m128i below = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)lo),x);
+    __m128i above = _mm_subs_epu8(x,_mm_loadu_si128((const __m128i*)hi));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(below,above),_mm_setzero_si128()))==0xffff;
+#else
+    static const char pat[9] = "AA0AA000";
+    if(p[0]<'A' || p[0]>'D' || p[1]!=' ' || p[2]<'1' || p[2]>'3' || p[3]!=' ' || p[12]!='\n') return false;
+    for(int i=0;i<8;i++){
+        char c = p[4+i];
+        if(pat[i]=='A' ? (c<'A' || c>'Z') : (c<'0' || c>'9')) return false;
+    }
+    return true;
+#endif
+}
+
+// Scalar parse of one line [p,eol) with the same acceptance as sscanf("%c %d %9s")
+static inline bool vpParseLine(const char* p, const char* eol, char* road, int* lane, char* id){
+    if(eol>p && eol[-1]=='\r') eol--;
+    if(p>=eol) return false;
+    *road = *p++;
+    while(p<eol && (*p==' ' || *p=='\t')) p++;
+    bool neg = false;
+    if(p<eol && (*p=='-' || *p=='+')) neg = *p++=='-';
+    if(p>=eol || *p<'0' || *p>'9') return false;
+    int n = 0;
+    while(p<eol && *p>='0' && *p<='9') n = n*10 + (*p++-'0');
+    *lane = neg ? -n : n;
+    while(p<eol && (*p==' ' || *p=='\t')) p++;
+    int len = 0;
+    while(p<eol && *p!=' ' && *p!='\t' && len<VP_ID_MAX) id[len++] = *p++;
+    if(len==0) return false;
+    id[len] = 0;
+    return true;
+}
+
+// Cursor over a mapped buffer
+typedef struct {
+    const char* cur;
+    const char* end;
+} VehicleScanner;
+
+static inline void vsInit(VehicleScanner* s, const char* data, size_t len){
+    s->cur = data;
+    s->end = data+len;
+}
+
+// Parse the next complete line directly into the caller's fields (id needs VP_ID_MAX+1 bytes).
+// Returns 1 for a record, 0 for a malformed line that was skipped, -1 when no complete line is left.
+static inline int vsNext(VehicleScanner* s, char* road, int* lane, char* id){
+    const char* p = s->cur;
+    if(s->end-p >= 16 && vpIsFixedRecord(p)){
+        *road = p[0];
+        *lane = p[2]-'0';
+        memcpy(id,p+4,8);
+        id[8] = 0;
+        s->cur = p+VP_RECORD_LEN;
+        return 1;
+    }
+    const char* nl = vpFindNewline(p,s->end);
+    if(!nl) return -1;
+    s->cur = nl+1;
+    return vpParseLine(p,nl,road,lane,id) ? 1 : 0;
+}
+
+// Bytes consumed so far, i.e. the offset just past the last complete line
+static inline size_t vsConsumed(const VehicleScanner* s, const char* data){
+    return (size_t)(s->cur-data);
+}
+
+#endif
@@ -0,0 +1,156 @@
+// Work-stealing thread pool for data-parallel loops over independent items.
+//
+// wpRun() splits the items [0, count) evenly into one range per thread. Each thread takes
+// grain-sized chunks from the front of its own range; one that runs dry steals the back half
+// of another's range. That moves work only when the split turns out uneven.
+// Items never create more work, so a thread is finished once every range is empty.
+// The thread calling wpRun() works too, as thread 0, so a pool of one creates no threads
+// and runs the loop inline.
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define WP_MAX_THREADS 64
+
+// Process items [begin, end)
+typedef void (*PoolTask)(void* ctx, int begin, int end);
+
+typedef struct {
+    SDL_SpinLock lock;       // guards begin and end: the owner and thieves both take from here
+    int begin, end;          // items not yet taken
+    char pad[64];            // keep each thread's range on its own cache line
+} WorkRange;
+
+typedef struct WorkPool WorkPool;
+
+typedef struct {
+    WorkPool* pool;
+    int index;
+    SDL_Thread* thread;
+    SDL_sem* wake;           // posted once per wpRun()
+} WorkThread;
+
+struct WorkPool {
+    int threads;             // including the one calling wpRun()
+    WorkRange range[WP_MAX_THREADS];
+    WorkThread worker[WP_MAX_THREADS];  // [0] is the caller and has no thread
+    PoolTask task;
+    void* ctx;
+    int grain;
+    SDL_atomic_t pending;    // threads still working on the current run
+    SDL_sem* done;           // posted by the last of them to finish
+    SDL_atomic_t quit;
+    SDL_atomic_t steals;     // running total, for reports
+};
+
+// Take the next chunk of thread self's own range
+static bool wpTake(WorkPool* p, int self, int* begin, int* end){
+    WorkRange* r = &p->range[self];
+    SDL_AtomicLock(&r->lock);
+    bool got = r->begin<r->end;
+    if(got){
+        *begin = r->begin;
+        *end = r->end-r->begin>p->grain ? r->begin+p->grain : r->end;
+        r->begin = *end;
+    }
+    SDL_AtomicUnlock(&r->lock);
+    return got;
+}
+
+// Move the back half of another thread's range into self's (empty) one. False if every
+// range was empty.
+static bool wpSteal(WorkPool* p, int self){
+    for(int k=1;k<p->threads;k++){
+        WorkRange* victim = &p->range[(self+k)%p->threads];
+        SDL_AtomicLock(&victim->lock);
+        int begin = victim->begin+(victim->end-victim->begin)/2, end = victim->end;
+        if(begin<end) victim->end = begin;
+        SDL_AtomicUnlock(&victim->lock);
+        if(begin>=end) continue;
+        WorkRange* own = &p->range[self];
+        SDL_AtomicLock(&own->lock);
+        own->begin = begin;
+        own->end = end;
+        SDL_AtomicUnlock(&own->lock);
+        SDL_AtomicAdd(&p->steals,1);
+        return true;
+    }
+    return false;
+}
+
+static void wpWork(WorkPool* p, int self){
+    int begin, end;
+    while(1){
+        if(wpTake(p,self,&begin,&end)) p->task(p->ctx,begin,end);
+        else if(!wpSteal(p,self)) return;
+    }
+}
+
+static int wpWorker(void* arg){
+    WorkThread* w = (WorkThread*)arg;
+    WorkPool* p = w->pool;
+    while(1){
+        SDL_SemWait(w->wake);
+        if(SDL_AtomicGet(&p->quit)) return 0;
+        wpWork(p,w->index);
+        if(SDL_AtomicAdd(&p->pending,-1)==1) SDL_SemPost(p->done);
+    }
+}
+
+// Start a pool of threads threads (the caller of wpRun() being one of them). If some cannot
+// be created the pool runs with fewer; false only if it cannot run at all.
+static bool wpInit(WorkPool* p, int threads){
+    memset(p,0,sizeof(*p));
+    if(threads<1) threads = 1;
+    if(threads>WP_MAX_THREADS) threads = WP_MAX_THREADS;
+    p->done = SDL_CreateSemaphore(0);
+    if(!p->done) return false;
+    p->threads = 1;
+    for(int i=1;i<threads;i++){
+        WorkThread* w = &p->worker[i];
+        w->pool = p;
+        w->index = i;
+        w->wake = SDL_CreateSemaphore(0);
+        if(w->wake) w->thread = SDL_CreateThread(wpWorker,"workPool",w);
+        if(!w->thread){
+            if(w->wake) SDL_DestroySemaphore(w->wake);
+            w->wake = NULL;
+            break;
+        }
+        p->threads++;
+    }
+    return true;
+}
+
+// Call task on chunks of [0, count) across the pool and return when all are done. grain is
+// the most items one call gets; smaller spreads the work better, larger costs less locking.
+static void wpRun(WorkPool* p, int count, int grain, PoolTask task, void* ctx){
+    if(count<=0) return;
+    p->task = task;
+    p->ctx = ctx;
+    p->grain = grain>0 ? grain : 1;
+    for(int i=0;i<p->threads;i++){
+        p->range[i].begin = (int)((long long)count*i/p->threads);
+        p->range[i].end = (int)((long long)count*(i+1)/p->threads);
+    }
+    SDL_AtomicSet(&p->pending,p->threads);
+    for(int i=1;i<p->threads;i++) SDL_SemPost(p->worker[i].wake);
+    wpWork(p,0);
+    if(SDL_AtomicAdd(&p->pending,-1)!=1) SDL_SemWait(p->done);
+}
+
+static void wpFree(WorkPool* p){
+    SDL_AtomicSet(&p->quit,1);
+    for(int i=1;i<p->threads;i++) SDL_SemPost(p->worker[i].wake);
+    for(int i=1;i<p->threads;i++){
+        SDL_WaitThread(p->worker[i].thread,NULL);
+        SDL_DestroySemaphore(p->worker[i].wake);
+    }
+    if(p->done) SDL_DestroySemaphore(p->done);
+    memset(p,0,sizeof(*p));
+}
+
+#endif